@@ -0,0 +1,79 @@
+
+#include "advise.h++"
+
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace Static;
+
+
+AccessPlan::AccessPlan(const File &file, std::vector<FileInfo> order, uint64_t window)
+        : file(&file), order(std::move(order)), window(window), pageSize(sysconf(_SC_PAGESIZE)) {
+    hint(0, 0, POSIX_FADV_RANDOM, MADV_RANDOM);
+    advance(0);
+}
+
+AccessPlan::AccessPlan(const Mapping &mapping, std::vector<FileInfo> order, uint64_t window)
+        : mapping(&mapping), order(std::move(order)), window(window), pageSize(sysconf(_SC_PAGESIZE)) {
+    // the mapped data need not start at a page boundary
+    phase = (uintptr_t)mapping.getData().data() % pageSize;
+    hint(0, 0, POSIX_FADV_RANDOM, MADV_RANDOM);
+    advance(0);
+}
+
+AccessPlan::AccessPlan(AccessPlan &&other) noexcept
+        : file(std::exchange(other.file, nullptr)), mapping(std::exchange(other.mapping, nullptr)),
+          order(std::move(other.order)), window(other.window), pageSize(other.pageSize), phase(other.phase),
+          consumed(other.consumed), hinted(other.hinted), hintedBytes(other.hintedBytes) {}
+
+AccessPlan::~AccessPlan() {
+    // give the kernel its own readahead heuristics back
+    hint(0, 0, POSIX_FADV_NORMAL, MADV_NORMAL);
+}
+
+void AccessPlan::advance(uint64_t position) {
+    position = std::min<uint64_t>(position, order.size());
+
+    for (; consumed < position; consumed++) {
+        const FileInfo &info = order[consumed];
+        uint64_t begin = (info.dataOffset + phase + pageSize - 1) / pageSize * pageSize;
+        uint64_t end = (info.dataOffset + phase + info.size) / pageSize * pageSize;
+        if (begin < end)
+            hint(begin - phase, end - begin, POSIX_FADV_DONTNEED, MADV_DONTNEED);
+
+        if (consumed < hinted)
+            hintedBytes -= info.size;
+    }
+    hinted = std::max(hinted, consumed);
+
+    // neighbouring payloads are announced as one range
+    uint64_t rangeBegin = 0, rangeEnd = 0;
+    for (; hinted < order.size() && hintedBytes < window; hinted++) {
+        const FileInfo &info = order[hinted];
+        uint64_t end = info.dataOffset + info.size;
+
+        if (rangeEnd == rangeBegin || info.dataOffset > rangeEnd + STATIC_MERGE_GAP || end < rangeBegin) {
+            if (rangeEnd > rangeBegin)
+                hint(rangeBegin, rangeEnd - rangeBegin, POSIX_FADV_WILLNEED, MADV_WILLNEED);
+            rangeBegin = info.dataOffset;
+            rangeEnd = end;
+        } else {
+            rangeBegin = std::min(rangeBegin, info.dataOffset);
+            rangeEnd = std::max(rangeEnd, end);
+        }
+        hintedBytes += info.size;
+    }
+    if (rangeEnd > rangeBegin)
+        hint(rangeBegin, rangeEnd - rangeBegin, POSIX_FADV_WILLNEED, MADV_WILLNEED);
+}
+
+const std::vector<FileInfo> &AccessPlan::getOrder() const noexcept { return order; }
+
+void AccessPlan::hint(uint64_t offset, uint64_t size, int fileAdvice, int mappingAdvice) const noexcept {
+    if (file)
+        file->advise(offset, size, fileAdvice);
+    else if (mapping)
+        mapping->advise(offset, size, mappingAdvice);
+}
@@ -0,0 +1,44 @@
+
+#ifndef STATICARCHIVE_ADVISE_H
+#define STATICARCHIVE_ADVISE_H
+
+#include "static.h++"
+
+namespace Static {
+
+    // Tells the kernel about a known access order. Creating the plan switches the
+    // archive to random access, so the kernel stops its sequential readahead. As
+    // the consumer advances, the next `window` bytes of payloads are announced
+    // (WILLNEED) and the pages of consumed payloads are released (DONTNEED). Only
+    // pages completely covered by a consumed payload are released, a page shared
+    // with another entry stays cached. Plans over a Mapping give the same hints
+    // with madvise, the file hints do not drive the readahead of a mapping.
+    class AccessPlan {
+    public:
+        AccessPlan(const File &file, std::vector<FileInfo> order, uint64_t window = STATIC_HINT_WINDOW);
+        // the data offsets of order are relative to the start of the mapped data
+        AccessPlan(const Mapping &mapping, std::vector<FileInfo> order, uint64_t window = STATIC_HINT_WINDOW);
+        AccessPlan(AccessPlan &&other) noexcept;
+        ~AccessPlan();
+
+        // Everything before position was consumed, position is the next entry to be read.
+        void advance(uint64_t position);
+
+        [[nodiscard]] const std::vector<FileInfo> &getOrder() const noexcept;
+    private:
+        // posix_fadvise for files, madvise for mappings
+        void hint(uint64_t offset, uint64_t size, int fileAdvice, int mappingAdvice) const noexcept;
+
+        const File *file = nullptr;
+        const Mapping *mapping = nullptr;
+        std::vector<FileInfo> order;
+        uint64_t window;
+        uint64_t pageSize;
+        uint64_t phase = 0; // of offset 0 inside its page
+        uint64_t consumed = 0;
+        uint64_t hinted = 0;
+        uint64_t hintedBytes = 0;
+    };
+}
+
+#endif //STATICARCHIVE_ADVISE_H
@@ -0,0 +1,58 @@
+
+#ifndef STATICARCHIVE_EMBEDDED_H
+#define STATICARCHIVE_EMBEDDED_H
+
+#include "phash.h++"
+
+#include <span>
+#include <string_view>
+
+namespace Static {
+
+    struct EmbeddedEntry {
+        std::string_view name;
+        uint64_t dataOffset;
+        uint64_t size;
+        uint32_t crc;
+    };
+
+    // An archive compiled into the binary by static_embed_directory() (CMake).
+    // The entries are stored in the slot order of a perfect hash, so a lookup is
+    // one hash of the name and one comparison. Nothing is parsed at runtime and
+    // lookups of constant names can be evaluated at compile time.
+    class EmbeddedArchive {
+    public:
+        constexpr EmbeddedArchive(const uint8_t *data, uint64_t size, std::span<const EmbeddedEntry> entries,
+                                  std::span<const uint32_t> displacements, uint64_t seed) noexcept
+                : data(data), size(size), entries(entries), displacements(displacements), seed(seed) {}
+
+        // nullptr if the name is not contained
+        [[nodiscard]] constexpr const EmbeddedEntry *findEntry(std::string_view name) const noexcept {
+            if (entries.empty())
+                return nullptr;
+
+            const EmbeddedEntry &entry = entries[perfectHashSlot(name, seed, entries.size(), displacements)];
+            return entry.name == name ? &entry : nullptr;
+        }
+
+        // the payload of name, empty if the name is not contained
+        [[nodiscard]] constexpr std::span<const uint8_t> find(std::string_view name) const noexcept {
+            const EmbeddedEntry *entry = findEntry(name);
+            if (entry == nullptr)
+                return {};
+            return {data + entry->dataOffset, entry->size};
+        }
+
+        // the complete archive, signature included, a MemoryArchive can walk it
+        [[nodiscard]] constexpr std::span<const uint8_t> getData() const noexcept { return {data, size}; }
+        [[nodiscard]] constexpr std::span<const EmbeddedEntry> getEntries() const noexcept { return entries; }
+    private:
+        const uint8_t *data;
+        uint64_t size;
+        std::span<const EmbeddedEntry> entries;
+        std::span<const uint32_t> displacements;
+        uint64_t seed;
+    };
+}
+
+#endif //STATICARCHIVE_EMBEDDED_H
@@ -7,6 +7,10 @@
 #define DWORD 4
 #define QWORD 8
 
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 
 template <typename T>
 union conv {
@@ -14,6 +18,57 @@ union conv {
     uint8_t data[sizeof(T)];
 };
 
+// append a field to a byte buffer (like conv, the host is expected to be little endian)
+template <typename T>
+inline void putField(std::vector<uint8_t> &buffer, T value) {
+    conv<T> c{value};
+    buffer.insert(buffer.end(), c.data, c.data + sizeof(T));
+}
+
+// Appends values with `bits` bits each, the first one in the lowest bits, as
+// u64 words, so (values.size() * bits + 63) / 64 words. Values must fit into bits.
+inline void putPacked(std::vector<uint8_t> &buffer, const std::vector<uint64_t> &values, uint8_t bits) {
+    uint64_t word = 0;
+    uint8_t used = 0;
+    for (size_t i = 0; bits > 0 && i < values.size(); i++) {
+        word |= values[i] << used;
+        if (used + bits < 64) {
+            used += bits;
+            continue;
+        }
+        putField<uint64_t>(buffer, word);
+        word = used > 0 ? values[i] >> (64 - used) : 0;
+        used = used + bits - 64;
+    }
+    if (used > 0)
+        putField<uint64_t>(buffer, word);
+}
+
+template <typename T>
+inline T getField(const uint8_t *data) {
+    conv<T> c{};
+    memcpy(c.data, data, sizeof(T));
+    return c.value;
+}
+
+// LEB128: 7 bits per byte, the high bit marks that another byte follows
+#define VARINT_MAX 10
+
+inline uint8_t varintSize(uint64_t value) {
+    uint8_t size = 1;
+    for (; value >= 0x80; value >>= 7)
+        size++;
+    return size;
+}
+
+// encodes value into out (at least VARINT_MAX bytes), returns the amount of bytes used
+inline uint8_t putVarint(uint8_t *out, uint64_t value) {
+    uint8_t size = 0;
+    for (; value >= 0x80; value >>= 7)
+        out[size++] = (uint8_t)(value | 0x80);
+    out[size++] = (uint8_t)value;
+    return size;
+}
 
 
 #endif //STATICARCHIVE_HELPERS_H
@@ -0,0 +1,238 @@
+
+#include "io.h++"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace Static;
+
+
+File::File(const std::string &path, int flags, int permissions) {
+    handle = ::open(path.c_str(), flags | O_CLOEXEC, permissions);
+    if (handle < 0)
+        throw std::system_error(errno, std::generic_category(), "Could not open " + path);
+}
+
+File::File(File &&other) noexcept {
+    handle = std::exchange(other.handle, -1);
+}
+
+File &File::operator=(File &&other) noexcept {
+    if (this != &other) {
+        close();
+        handle = std::exchange(other.handle, -1);
+    }
+    return *this;
+}
+
+File::~File() {
+    close();
+}
+
+void File::preallocate(uint64_t offset, uint64_t size, bool keepSize) const noexcept {
+    if (handle < 0 || size == 0)
+        return;
+
+#ifdef __linux__
+    ::fallocate(handle, keepSize ? FALLOC_FL_KEEP_SIZE : 0, (off_t)offset, (off_t)size);
+#else
+    if (!keepSize)
+        ::posix_fallocate(handle, (off_t)offset, (off_t)size);
+#endif
+}
+
+void File::advise(uint64_t offset, uint64_t size, int advice) const noexcept {
+    if (handle >= 0)
+        ::posix_fadvise(handle, (off_t)offset, (off_t)size, advice);
+}
+
+void File::write(const char *data, uint64_t size) const {
+    while (size > 0) {
+        ssize_t written = ::write(handle, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "Write failed");
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void File::write(uint64_t offset, std::vector<iovec> &segments) const {
+    size_t first = 0;
+    while (first < segments.size() && segments[first].iov_len == 0)
+        first++;
+
+    while (first < segments.size()) {
+        int count = (int)std::min<size_t>(segments.size() - first, IOV_MAX);
+        ssize_t result = ::pwritev(handle, &segments[first], count, (off_t)offset);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "Write failed");
+        }
+        offset += result;
+
+        // skip what was written, a partially written segment is shrunk
+        for (auto left = (size_t)result; left > 0 && first < segments.size(); first++) {
+            iovec &segment = segments[first];
+            if (left < segment.iov_len) {
+                segment.iov_base = (char*)segment.iov_base + left;
+                segment.iov_len -= left;
+                break;
+            }
+            left -= segment.iov_len;
+        }
+        while (first < segments.size() && segments[first].iov_len == 0)
+            first++;
+    }
+}
+
+void File::truncate(uint64_t size) const {
+    if (::ftruncate(handle, (off_t)size) < 0)
+        throw std::system_error(errno, std::generic_category(), "Truncate failed");
+}
+
+void File::sync() const {
+#ifdef __linux__
+    int result = ::fdatasync(handle);
+#else
+    int result = ::fsync(handle);
+#endif
+    if (result < 0)
+        throw std::system_error(errno, std::generic_category(), "Sync failed");
+}
+
+uint64_t File::read(uint64_t offset, char *out, uint64_t size) const {
+    uint64_t done = 0;
+    while (done < size) {
+        ssize_t count = ::pread(handle, out + done, size - done, (off_t)(offset + done));
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "Read failed");
+        }
+        if (count == 0)
+            break;
+        done += count;
+    }
+    return done;
+}
+
+uint64_t File::read(uint64_t offset, std::vector<iovec> &segments) const {
+    uint64_t done = 0;
+    size_t first = 0;
+
+    while (first < segments.size()) {
+        int count = (int)std::min<size_t>(segments.size() - first, IOV_MAX);
+        ssize_t result = ::preadv(handle, &segments[first], count, (off_t)(offset + done));
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "Read failed");
+        }
+        if (result == 0)
+            break;
+        done += result;
+
+        // skip what was filled, a partially filled segment is shrunk
+        for (auto left = (size_t)result; left > 0 && first < segments.size(); first++) {
+            iovec &segment = segments[first];
+            if (left < segment.iov_len) {
+                segment.iov_base = (char*)segment.iov_base + left;
+                segment.iov_len -= left;
+                break;
+            }
+            left -= segment.iov_len;
+        }
+        while (first < segments.size() && segments[first].iov_len == 0)
+            first++;
+    }
+    return done;
+}
+
+void File::close() {
+    if (handle >= 0)
+        ::close(handle);
+    handle = -1;
+}
+
+bool File::isOpen() const noexcept { return handle >= 0; }
+
+int File::getHandle() const noexcept { return handle; }
+
+uint64_t File::getSize() const {
+    struct stat info{};
+    if (::fstat(handle, &info) < 0)
+        throw std::system_error(errno, std::generic_category(), "Stat failed");
+    return info.st_size;
+}
+
+
+Mapping::Mapping(const File &file, uint64_t offset, uint64_t size) {
+    if (size == 0)
+        return;
+
+    auto pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    skip = offset % pageSize;
+    length = skip + size;
+    base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, file.getHandle(), (off_t)(offset - skip));
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        throw std::system_error(errno, std::generic_category(), "Mapping failed");
+    }
+}
+
+Mapping::Mapping(Mapping &&other) noexcept {
+    base = std::exchange(other.base, nullptr);
+    length = std::exchange(other.length, 0);
+    skip = std::exchange(other.skip, 0);
+}
+
+Mapping &Mapping::operator=(Mapping &&other) noexcept {
+    if (this != &other) {
+        close();
+        base = std::exchange(other.base, nullptr);
+        length = std::exchange(other.length, 0);
+        skip = std::exchange(other.skip, 0);
+    }
+    return *this;
+}
+
+Mapping::~Mapping() {
+    close();
+}
+
+void Mapping::close() {
+    if (base != nullptr)
+        ::munmap(base, length);
+    base = nullptr;
+    length = 0;
+    skip = 0;
+}
+
+bool Mapping::isOpen() const noexcept { return base != nullptr; }
+
+std::span<const uint8_t> Mapping::getData() const noexcept {
+    if (base == nullptr)
+        return {};
+    return {(const uint8_t*)base + skip, length - skip};
+}
+
+void Mapping::advise(uint64_t offset, uint64_t size, int advice) const noexcept {
+    if (base == nullptr || skip + offset >= length)
+        return;
+
+    auto pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t begin = (skip + offset) / pageSize * pageSize;
+    uint64_t end = size == 0 ? length : std::min(length, skip + offset + size);
+    ::madvise((char*)base + begin, end - begin, advice);
+}
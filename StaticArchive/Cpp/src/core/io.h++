@@ -0,0 +1,79 @@
+
+#ifndef STATICARCHIVE_IO_H
+#define STATICARCHIVE_IO_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+namespace Static {
+
+    // Thin owner of a POSIX file descriptor, used where the std streams
+    // cannot express what we need (preallocation, positional I/O, hints).
+    class File {
+    public:
+        File() = default;
+        File(const std::string &path, int flags, int permissions = 0644);
+        File(const File &) = delete;
+        File(File &&other) noexcept;
+        File &operator=(const File &) = delete;
+        File &operator=(File &&other) noexcept;
+        ~File();
+
+        // Reserves disk space for [offset, offset + size). With keepSize the
+        // visible file size is left untouched (Linux only). Preallocation is a
+        // hint, filesystems that cannot do it are silently ignored.
+        void preallocate(uint64_t offset, uint64_t size, bool keepSize = false) const noexcept;
+        // posix_fadvise hint for [offset, offset + size), failures are ignored
+        void advise(uint64_t offset, uint64_t size, int advice) const noexcept;
+        void write(const char *data, uint64_t size) const;
+        // Positional gather write of all segments, continues after short writes.
+        // The segments are consumed (modified) in the process.
+        void write(uint64_t offset, std::vector<iovec> &segments) const;
+        void truncate(uint64_t size) const;
+        // fdatasync where available, the data is on disk when it returns
+        void sync() const;
+        // Positional read, does not touch the file offset and is safe to call
+        // from several threads. Returns the amount of bytes read (short at EOF).
+        uint64_t read(uint64_t offset, char *out, uint64_t size) const;
+        // Positional scatter read into the segments, continues after short reads.
+        // The segments are consumed (modified) in the process.
+        uint64_t read(uint64_t offset, std::vector<iovec> &segments) const;
+        void close();
+
+        [[nodiscard]] bool isOpen() const noexcept;
+        [[nodiscard]] int getHandle() const noexcept;
+        [[nodiscard]] uint64_t getSize() const;
+    private:
+        int handle = -1;
+    };
+
+    // Read-only shared mapping of [offset, offset + size) of a file, the
+    // offset does not have to be page aligned.
+    class Mapping {
+    public:
+        Mapping() = default;
+        Mapping(const File &file, uint64_t offset, uint64_t size);
+        Mapping(const Mapping &) = delete;
+        Mapping(Mapping &&other) noexcept;
+        Mapping &operator=(const Mapping &) = delete;
+        Mapping &operator=(Mapping &&other) noexcept;
+        ~Mapping();
+
+        void close();
+
+        [[nodiscard]] bool isOpen() const noexcept;
+        [[nodiscard]] std::span<const uint8_t> getData() const noexcept;
+        // madvise hint for [offset, offset + size) of getData(), size 0 means up to
+        // the end. The start is rounded down to its page, failures are ignored.
+        void advise(uint64_t offset, uint64_t size, int advice) const noexcept;
+    private:
+        void *base = nullptr;
+        uint64_t length = 0; // of the whole mapping
+        uint64_t skip = 0;   // from the page boundary to the requested offset
+    };
+}
+
+#endif //STATICARCHIVE_IO_H
@@ -0,0 +1,136 @@
+
+#include "loader.h++"
+
+#include <chrono>
+#include <stdexcept>
+
+using namespace Static;
+
+
+// spins shortly, then yields and finally sleeps while waiting on a queue
+static void backoff(unsigned &attempt) {
+    if (attempt >= 128)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    else if (attempt >= 64)
+        std::this_thread::yield();
+    attempt++;
+}
+
+Loader::Loader(StaticArchive &archive, std::vector<FileInfo> files, unsigned ioThreads,
+               unsigned verifyThreads, size_t capacity, size_t batchSize)
+        : archive(archive), files(std::move(files)), batchSize(std::max<size_t>(batchSize, 1)),
+          pending(capacity), ready(capacity) {
+    if (!archive.getPositionalReads())
+        throw std::invalid_argument("The loader needs an archive opened read-only from a path");
+
+    ioThreads = std::max(ioThreads, 1u);
+    verifyStage = verifyThreads > 0 && archive.checks && archive.getWriteCrc();
+
+    reading = ioThreads;
+    for (unsigned i = 0; i < ioThreads; i++)
+        workers.emplace_back(&Loader::readLoop, this);
+    for (unsigned i = 0; verifyStage && i < verifyThreads; i++)
+        workers.emplace_back(&Loader::verifyLoop, this);
+}
+
+Loader::~Loader() {
+    stop();
+}
+
+bool Loader::pop(Sample &out) {
+    // every consumer claims one of the remaining samples before it waits for one
+    if (claimed.fetch_add(1, std::memory_order_relaxed) >= files.size())
+        return false;
+
+    for (unsigned attempt = 0;; backoff(attempt)) {
+        if (stopping.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> guard(errorLock);
+            if (error)
+                std::rethrow_exception(error);
+            return false;
+        }
+
+        if (ready.tryPop(out)) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+void Loader::stop() {
+    stopping.store(true, std::memory_order_release);
+    for (std::thread &worker : workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+uint64_t Loader::getDelivered() const noexcept { return delivered.load(std::memory_order_relaxed); }
+
+void Loader::readLoop() {
+    std::vector<std::span<char>> buffers;
+    std::vector<Sample> samples;
+
+    try {
+        while (!stopping.load(std::memory_order_relaxed)) {
+            size_t first = next.fetch_add(batchSize, std::memory_order_relaxed);
+            if (first >= files.size())
+                break;
+
+            std::span<const FileInfo> batch(files.data() + first, std::min(batchSize, files.size() - first));
+            samples.resize(batch.size());
+            buffers.clear();
+            for (size_t i = 0; i < batch.size(); i++) {
+                samples[i].info = batch[i];
+                samples[i].data.resize(batch[i].size);
+                buffers.emplace_back(samples[i].data.data(), samples[i].data.size());
+            }
+
+            // checksums are left to the verify stage if there is one
+            archive.readBatch(batch, buffers, verifyStage ? 0 : 1);
+
+            for (Sample &sample : samples)
+                push(verifyStage ? pending : ready, sample);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    reading.fetch_sub(1, std::memory_order_release);
+}
+
+void Loader::verifyLoop() {
+    Sample sample;
+
+    try {
+        for (unsigned attempt = 0; !stopping.load(std::memory_order_relaxed);) {
+            // checked before popping, so no sample of a finished reader is missed
+            bool drained = reading.load(std::memory_order_acquire) == 0;
+
+            if (pending.tryPop(sample)) {
+                archive.verify(sample.info, sample.data.data());
+                push(ready, sample);
+                attempt = 0;
+            } else if (drained) {
+                break;
+            } else {
+                backoff(attempt);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void Loader::push(BoundedQueue<Sample> &queue, Sample &sample) {
+    for (unsigned attempt = 0; !queue.tryPush(sample); backoff(attempt)) {
+        if (stopping.load(std::memory_order_relaxed))
+            return;
+    }
+}
+
+void Loader::fail(std::exception_ptr exception) {
+    std::lock_guard<std::mutex> guard(errorLock);
+    if (!error)
+        error = std::move(exception);
+    stopping.store(true, std::memory_order_release);
+}
@@ -0,0 +1,63 @@
+
+#ifndef STATICARCHIVE_LOADER_H
+#define STATICARCHIVE_LOADER_H
+
+#include "static.h++"
+#include "sampler.h++"
+#include "queue.h++"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Static {
+
+    // Input pipeline: ioThreads read the payloads in small batches (see readBatch),
+    // verifyThreads check their checksums and the results are handed out through a
+    // bounded queue. When the consumers fall behind the queues fill up and the
+    // workers wait, so at most about 2 * capacity samples are held in memory.
+    // Samples are delivered in completion order, not in the order of files.
+    // The archive must support positional reads (read-only, opened from a path).
+    class Loader {
+    public:
+        Loader(StaticArchive &archive, std::vector<FileInfo> files, unsigned ioThreads = 2,
+               unsigned verifyThreads = 1, size_t capacity = 64, size_t batchSize = 16);
+        Loader(const Loader &) = delete;
+        Loader &operator=(const Loader &) = delete;
+        ~Loader();
+
+        // Blocks until a sample is ready, may be called from several consumer threads.
+        // Returns false once every file was claimed by a call or the loader was
+        // stopped, rethrows errors of the workers.
+        bool pop(Sample &out);
+        // Stops and joins all workers, samples not yet popped are dropped.
+        void stop();
+
+        [[nodiscard]] uint64_t getDelivered() const noexcept;
+    private:
+        void readLoop();
+        void verifyLoop();
+        void push(BoundedQueue<Sample> &queue, Sample &sample);
+        void fail(std::exception_ptr exception);
+
+        StaticArchive &archive;
+        std::vector<FileInfo> files;
+        size_t batchSize;
+        bool verifyStage;
+
+        BoundedQueue<Sample> pending;
+        BoundedQueue<Sample> ready;
+        std::atomic<size_t> next{0};
+        std::atomic<unsigned> reading{0};
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> claimed{0};
+        std::atomic<uint64_t> delivered{0};
+
+        std::mutex errorLock;
+        std::exception_ptr error;
+        std::vector<std::thread> workers;
+    };
+}
+
+#endif //STATICARCHIVE_LOADER_H
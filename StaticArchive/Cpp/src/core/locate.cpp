@@ -0,0 +1,64 @@
+
+#include "locate.h++"
+#include "helpers.h++"
+
+#include <algorithm>
+#include <fstream>
+#include <fcntl.h>
+
+using namespace Static;
+
+
+std::optional<ArchiveLocation> Static::locateArchive(const File &file) {
+    uint64_t fileSize = file.getSize();
+    if (fileSize < STATIC_TRAILER_SIZE)
+        return std::nullopt;
+
+    uint8_t trailer[STATIC_TRAILER_SIZE];
+    if (file.read(fileSize - STATIC_TRAILER_SIZE, (char*)trailer, STATIC_TRAILER_SIZE) != STATIC_TRAILER_SIZE)
+        return std::nullopt;
+
+    uint8_t magic[QWORD] = STATIC_TRAILER_MAGIC;
+    if (memcmp(magic, &trailer[2 * QWORD], QWORD) != 0)
+        return std::nullopt;
+
+    ArchiveLocation location{getField<uint64_t>(&trailer[0]), getField<uint64_t>(&trailer[QWORD])};
+    // the archive has to end right in front of the trailer
+    if (location.offset > fileSize - STATIC_TRAILER_SIZE ||
+        location.size != fileSize - STATIC_TRAILER_SIZE - location.offset)
+        return std::nullopt;
+    return location;
+}
+
+ArchiveLocation Static::attachArchive(const std::string &host, const std::string &archive, uint32_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+        throw std::invalid_argument("The alignment must be a power of two");
+
+    std::ifstream input(archive, std::ifstream::binary);
+    if (!input.is_open())
+        throw std::ios_base::failure("Could not open archive " + archive);
+
+    File file(host, O_WRONLY | O_APPEND);
+    uint64_t hostSize = file.getSize();
+    ArchiveLocation location{(hostSize + alignment - 1) & ~(uint64_t)(alignment - 1), 0};
+
+    // the alignment may exceed the buffer, the zero padding goes out in pieces
+    std::vector<char> buffer(STATIC_BUFFER_SIZE, 0);
+    for (uint64_t padding = location.offset - hostSize; padding > 0;) {
+        uint64_t size = std::min<uint64_t>(padding, buffer.size());
+        file.write(buffer.data(), size);
+        padding -= size;
+    }
+    while (input.read(buffer.data(), (std::streamsize)buffer.size()) || input.gcount() > 0) {
+        file.write(buffer.data(), input.gcount());
+        location.size += input.gcount();
+    }
+
+    std::vector<uint8_t> trailer;
+    putField<uint64_t>(trailer, location.offset);
+    putField<uint64_t>(trailer, location.size);
+    uint8_t magic[QWORD] = STATIC_TRAILER_MAGIC;
+    trailer.insert(trailer.end(), magic, magic + QWORD);
+    file.write((const char*)trailer.data(), trailer.size());
+    return location;
+}
@@ -0,0 +1,26 @@
+
+#ifndef STATICARCHIVE_LOCATE_H
+#define STATICARCHIVE_LOCATE_H
+
+#include "static.h++"
+
+#include <optional>
+
+namespace Static {
+
+    // Where an archive lives inside a larger file (an executable, a container).
+    struct ArchiveLocation {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // Reads the trailer at the end of the file, one read. Nothing if the file
+    // does not end with a trailer written by attachArchive.
+    std::optional<ArchiveLocation> locateArchive(const File &file);
+
+    // Appends the archive to host, starting at a multiple of alignment so payload
+    // alignment and mappings carry over, and writes a trailer behind it.
+    ArchiveLocation attachArchive(const std::string &host, const std::string &archive, uint32_t alignment = 4096);
+}
+
+#endif //STATICARCHIVE_LOCATE_H
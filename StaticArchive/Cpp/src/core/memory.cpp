@@ -0,0 +1,129 @@
+
+#include "memory.h++"
+
+#include <stdexcept>
+#include <fcntl.h>
+
+using namespace Static;
+
+
+MemoryArchive::MemoryArchive(std::span<const uint8_t> data) : data(data), sig(parseSignature(data)) {
+    // entry names are views into the memory, front coded names are not stored in one piece
+    if (sig.frontCoded)
+        throw std::invalid_argument("Front coded names are not supported in memory");
+    generalPurposeField = sig.generalPurposeField;
+
+    if (sig.sizeMode == SizeModeFixed && sig.tableOffset != 0) {
+        if (sig.fileCount > data.size())
+            throw std::out_of_range("Unexpected end of the record table");
+        rows.reserve(sig.fileCount);
+        ParsedEntry entry{};
+        for (uint64_t i = 0, row = sig.tableOffset; i < sig.fileCount; i++) {
+            rows.push_back(row);
+            parseTableRow(data, sig, row, entry);
+        }
+    }
+}
+
+void MemoryArchive::getEntries(std::vector<MemoryEntry> &out) const {
+    out.reserve(out.size() + sig.fileCount);
+    forEachEntry(data, sig, [this, &out](const ParsedEntry &entry) {
+        out.push_back(toEntry(entry));
+    });
+}
+
+MemoryEntry MemoryArchive::getEntry(std::string_view name) const {
+    if (!hasHeaders(sig.sizeMode)) {
+        std::vector<MemoryEntry> entries;
+        getEntries(entries);
+        for (const MemoryEntry &entry : entries) {
+            if (entry.name == name)
+                return entry;
+        }
+    } else {
+        std::optional<MemoryEntry> found = withHeaderCodec(sig, [&]<typename Codec>(Codec) -> std::optional<MemoryEntry> {
+            uint64_t offset = sig.dataStart;
+            for (uint64_t i = 0; i < sig.fileCount; i++) {
+                ParsedEntry entry = parseEntryWith<Codec>(data, sig, offset);
+                if (nameEquals(data, entry, name))
+                    return toEntry(entry);
+            }
+            return std::nullopt;
+        });
+        if (found)
+            return *found;
+    }
+    throw EntryNotFoundException(std::string(name));
+}
+
+MemoryEntry MemoryArchive::getRecord(uint64_t index) const {
+    if (sig.sizeMode != SizeModeFixed)
+        throw std::logic_error("Records are only addressable in SizeModeFixed");
+    if (index >= sig.fileCount)
+        throw std::out_of_range("Record index out of range");
+
+    uint64_t offset = sig.align(sig.dataStart) + index * sig.align(sig.recordSize);
+    ParsedEntry entry{0, 0, 0, offset, offset, sig.recordSize};
+    if (!rows.empty()) {
+        uint64_t row = rows[index];
+        parseTableRow(data, sig, row, entry);
+    }
+    return toEntry(entry);
+}
+
+std::span<const uint8_t> MemoryArchive::view(const FileInfo &file) const {
+    return slice(file.dataOffset, file.size);
+}
+
+void MemoryArchive::verify(const MemoryEntry &entry) const {
+    if (checks && sig.writeCrc)
+        checkCrc(entry.name, entry.crc, entry.data.data(), entry.data.size());
+}
+
+MemoryEntry MemoryArchive::toEntry(const ParsedEntry &entry) const {
+    return MemoryEntry{std::string_view((const char*)data.data() + entry.nameOffset, entry.nameSize),
+                       entry.crc,
+                       entry.offset,
+                       slice(entry.dataOffset, entry.size)};
+}
+
+std::span<const uint8_t> MemoryArchive::slice(uint64_t offset, uint64_t size) const {
+    if (offset > data.size() || size > data.size() - offset)
+        throw std::out_of_range("Unexpected end of archive");
+    return data.subspan(offset, size);
+}
+
+
+MappedArchive::MappedArchive(const std::string &path)
+        : file(path, O_RDONLY),
+          location(locateArchive(file).value_or(ArchiveLocation{0, file.getSize()})),
+          mapping(file, location.offset, location.size),
+          archive(mapping.getData()) {}
+
+
+// Properties
+std::span<const uint8_t> MemoryArchive::getData() const noexcept { return data; }
+
+SizeMode MemoryArchive::getSizeMode() const noexcept { return sig.sizeMode; }
+
+uint64_t MemoryArchive::getFileCount() const noexcept { return sig.fileCount; }
+
+uint64_t MemoryArchive::getRecordSize() const noexcept { return sig.recordSize; }
+
+uint32_t MemoryArchive::getAlignment() const noexcept { return sig.alignment; }
+
+bool MemoryArchive::getWriteCrc() const noexcept { return sig.writeCrc; }
+
+const MemoryArchive &MappedArchive::getArchive() const noexcept { return archive; }
+
+AccessPlan MappedArchive::getAccessPlan(std::span<const MemoryEntry> order, uint64_t window) const {
+    std::vector<FileInfo> infos;
+    infos.reserve(order.size());
+    for (const MemoryEntry &entry : order) {
+        uint64_t dataOffset = entry.data.data() - archive.getData().data();
+        infos.push_back(FileInfo{std::string(entry.name), entry.data.size(), entry.crc, entry.offset, dataOffset});
+    }
+    return AccessPlan(mapping, std::move(infos), window);
+}
+
+uint64_t MappedArchive::getBaseOffset() const noexcept { return location.offset; }
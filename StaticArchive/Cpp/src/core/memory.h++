@@ -0,0 +1,84 @@
+
+#ifndef STATICARCHIVE_MEMORY_H
+#define STATICARCHIVE_MEMORY_H
+
+#include "parse.h++"
+#include "locate.h++"
+#include "advise.h++"
+
+#include <string_view>
+
+namespace Static {
+
+    // An entry of a MemoryArchive, name and data point into the archive memory.
+    struct MemoryEntry {
+        std::string_view name; // empty for unnamed SizeModeFixed records
+        uint32_t crc;
+        uint64_t offset;
+        std::span<const uint8_t> data;
+    };
+
+    // Read-only archive over memory that is owned by someone else (linked into the
+    // binary, mapped, received over the network). The constructor checks the
+    // signature and walks the name table of SizeModeFixed records once, entries
+    // are parsed on demand and never copied, so the memory must
+    // outlive the archive and every entry taken from it. Archives with front coded
+    // names are rejected, their names are not stored in one piece. There are no
+    // readahead hints for memory of unknown origin, a MappedArchive gives them.
+    class MemoryArchive {
+    public:
+        explicit MemoryArchive(std::span<const uint8_t> data);
+
+        // Walks all headers, O(1) per entry.
+        void getEntries(std::vector<MemoryEntry> &out) const;
+        // Throws an EntryNotFoundException if no entry is called name.
+        MemoryEntry getEntry(std::string_view name) const;
+        // O(1) for SizeModeFixed archives, named records look up their row in a
+        // table of row offsets (8 bytes per record) built by the constructor.
+        MemoryEntry getRecord(uint64_t index) const;
+        // the payload of a FileInfo taken from a StaticArchive over the same bytes
+        std::span<const uint8_t> view(const FileInfo &file) const;
+
+        // checkCrc for the payload of entry, unless checks are disabled or the archive has no crcs
+        void verify(const MemoryEntry &entry) const;
+
+        [[nodiscard]] std::span<const uint8_t> getData() const noexcept;
+        [[nodiscard]] SizeMode getSizeMode() const noexcept;
+        [[nodiscard]] uint64_t getFileCount() const noexcept;
+        [[nodiscard]] uint64_t getRecordSize() const noexcept;
+        [[nodiscard]] uint32_t getAlignment() const noexcept;
+        [[nodiscard]] bool getWriteCrc() const noexcept;
+
+        uint32_t generalPurposeField = 0;
+        bool checks = true;
+    private:
+        [[nodiscard]] MemoryEntry toEntry(const ParsedEntry &entry) const;
+        [[nodiscard]] std::span<const uint8_t> slice(uint64_t offset, uint64_t size) const;
+
+        std::span<const uint8_t> data;
+        ParsedSignature sig;
+        std::vector<uint64_t> rows; // offsets of the record table rows, the rows vary in length
+    };
+
+    // A MemoryArchive over a read-only mapping of an archive file, or of the
+    // archive attached to a larger file (see attachArchive). Opening costs one
+    // read of the trailer and the mapping, nothing is copied.
+    class MappedArchive {
+    public:
+        explicit MappedArchive(const std::string &path);
+
+        [[nodiscard]] const MemoryArchive &getArchive() const noexcept;
+        // Readahead hints (madvise) for entries of getArchive() that will be read in
+        // the given order, see AccessPlan. The plan must not outlive the archive.
+        AccessPlan getAccessPlan(std::span<const MemoryEntry> order, uint64_t window = STATIC_HINT_WINDOW) const;
+        // where the archive starts inside the file
+        [[nodiscard]] uint64_t getBaseOffset() const noexcept;
+    private:
+        File file;
+        ArchiveLocation location;
+        Mapping mapping;
+        MemoryArchive archive;
+    };
+}
+
+#endif //STATICARCHIVE_MEMORY_H
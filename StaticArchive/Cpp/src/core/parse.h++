@@ -0,0 +1,521 @@
+
+#ifndef STATICARCHIVE_PARSE_H
+#define STATICARCHIVE_PARSE_H
+
+#include "static.h++"
+#include "helpers.h++"
+#include "phash.h++"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <string_view>
+
+// The archive layout (see static.bt) as constexpr functions over bytes. At
+// runtime they behave like any other parser, in a constant expression every
+// error (a throw) becomes a compile error, so embedded archives are validated
+// and indexed while building.
+
+namespace Static {
+
+    struct ParsedSignature {
+        uint32_t generalPurposeField = 0;
+        uint64_t fileCount = 0;
+        SizeMode sizeMode = SizeMode64;
+        bool writeCrc = false;
+        bool frontCoded = false;
+        uint64_t dataStart = STATIC_SIGNATURE_SIZE;
+        uint64_t recordSize = 0;
+        uint64_t tableOffset = 0;
+        uint32_t alignment = 1;
+        uint64_t indexOffset = 0;
+        uint64_t entriesEnd = 0;
+
+        [[nodiscard]] constexpr uint64_t align(uint64_t offset) const noexcept {
+            return (offset + alignment - 1) & ~(uint64_t)(alignment - 1);
+        }
+    };
+
+    // Names are kept as a range of the input, string_views into it cannot be
+    // formed in constant expressions when the input is not made of chars.
+    struct ParsedEntry {
+        uint64_t nameOffset;
+        uint8_t nameSize;
+        uint32_t crc;
+        uint64_t offset;     // header offset, the payload itself without headers
+        uint64_t dataOffset;
+        uint64_t size;
+        // front coded names: the name continues the first sharedSize bytes of the
+        // previous name, nameOffset and nameSize only cover the rest
+        uint8_t sharedSize = 0;
+    };
+
+    // little endian field at offset, throws std::out_of_range past the end
+    template<typename T>
+    constexpr T parseField(std::span<const uint8_t> data, uint64_t offset) {
+        if (offset > data.size() || sizeof(T) > data.size() - offset)
+            throw std::out_of_range("Unexpected end of archive");
+
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+            value |= (T)data[offset + i] << (8 * i);
+        return value;
+    }
+
+    // Value i of an array packed with putPacked into the u64 words at offset.
+    constexpr uint64_t parsePacked(std::span<const uint8_t> data, uint64_t offset, uint64_t i, uint8_t bits) {
+        if (bits == 0)
+            return 0;
+        uint64_t bit = i * bits;
+        uint64_t at = offset + bit / 64 * QWORD;
+        uint8_t shift = bit % 64;
+        uint64_t value = parseField<uint64_t>(data, at) >> shift;
+        if (shift + bits > 64)
+            value |= parseField<uint64_t>(data, at + QWORD) << (64 - shift);
+        return bits == 64 ? value : value & ((1ull << bits) - 1);
+    }
+
+    constexpr uint64_t packedSize(uint64_t count, uint8_t bits) noexcept {
+        return (count * bits + 63) / 64 * QWORD;
+    }
+
+    // LEB128 size field at offset, moves offset behind it. Sizes below 2^56 take
+    // at most 8 bytes, those are decoded from one 64 bit load without a loop.
+    constexpr uint64_t parseVarint(std::span<const uint8_t> data, uint64_t &offset) {
+        if (offset <= data.size() && data.size() - offset >= QWORD) {
+            uint64_t word = parseField<uint64_t>(data, offset);
+            uint64_t stops = ~word & 0x8080808080808080;
+            if (stops != 0) {
+                int length = std::countr_zero(stops) / 8 + 1;
+                offset += length;
+
+                // drop the bytes behind the varint and the continuation bits, then
+                // pack the 7 bit groups: pairs into 14 bits, 28 bits, 56 bits
+                uint64_t bits = (length == QWORD ? word : word & ((1ull << (8 * length)) - 1)) & 0x7f7f7f7f7f7f7f7f;
+                bits = ((bits & 0x7f007f007f007f00) >> 1) | (bits & 0x007f007f007f007f);
+                bits = ((bits & 0x3fff00003fff0000) >> 2) | (bits & 0x00003fff00003fff);
+                bits = ((bits & 0x0fffffff00000000) >> 4) | (bits & 0x000000000fffffff);
+                return bits;
+            }
+        }
+
+        // long sizes and the last bytes of the input
+        uint64_t value = 0;
+        for (int shift = 0; shift < 7 * VARINT_MAX; shift += 7) {
+            uint8_t byte = parseField<uint8_t>(data, offset++);
+            // the tenth byte only holds bit 63, anything more would be cut off
+            if (shift == 63 && byte > 1)
+                throw std::out_of_range("Invalid size field");
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::out_of_range("Invalid size field");
+    }
+
+    // Bytes of the signature and its extension, where the first entry starts.
+    // head needs the first STATIC_SIGNATURE_SIZE + DWORD bytes of extended archives.
+    constexpr uint64_t parseSignatureSize(std::span<const uint8_t> head) {
+        if (head.size() < STATIC_SIGNATURE_SIZE)
+            throw InvalidSignatureException();
+        if (!(head[21] & STATIC_SIG_EXTENDED))
+            return STATIC_SIGNATURE_SIZE;
+        if (head.size() < STATIC_SIGNATURE_SIZE + DWORD)
+            throw InvalidSignatureException();
+        return STATIC_SIGNATURE_SIZE + DWORD + parseField<uint32_t>(head, STATIC_SIGNATURE_SIZE);
+    }
+
+    // Throws an InvalidSignatureException if data does not start with a signature,
+    // without checkMagic only the fields behind the magic have to be valid.
+    constexpr ParsedSignature parseSignature(std::span<const uint8_t> data, bool checkMagic = true) {
+        constexpr uint8_t magic[QWORD] = STATIC_MAGIC;
+        if (data.size() < STATIC_SIGNATURE_SIZE)
+            throw InvalidSignatureException();
+        for (size_t i = 0; checkMagic && i < QWORD; i++) {
+            if (data[i] != magic[i])
+                throw InvalidSignatureException();
+        }
+
+        ParsedSignature sig;
+        sig.generalPurposeField = parseField<uint32_t>(data, 8);
+        sig.fileCount = parseField<uint64_t>(data, 12);
+        sig.sizeMode = (SizeMode)data[20];
+        sig.writeCrc = data[21] & STATIC_SIG_CRC;
+        sig.frontCoded = data[21] & STATIC_SIG_FRONT_CODED;
+
+        sig.dataStart = parseSignatureSize(data);
+        if (data.size() < sig.dataStart)
+            throw InvalidSignatureException();
+        if (data[21] & STATIC_SIG_EXTENDED) {
+            uint64_t ext = STATIC_SIGNATURE_SIZE + DWORD;
+            uint64_t extensionSize = sig.dataStart - ext;
+
+            // fields unknown to an older writer read as zero
+            auto field = [&]<typename T>(T, uint64_t at) {
+                return at + sizeof(T) <= extensionSize ? parseField<T>(data, ext + at) : T(0);
+            };
+            sig.recordSize = field(uint64_t(), 0);
+            sig.tableOffset = field(uint64_t(), 8);
+            sig.alignment = std::max<uint32_t>(field(uint32_t(), 16), 1);
+            sig.indexOffset = field(uint64_t(), 20);
+            sig.entriesEnd = field(uint64_t(), 28);
+        }
+
+        if (sig.sizeMode > SizeModeColumns || (sig.alignment & (sig.alignment - 1)) != 0)
+            throw InvalidSignatureException();
+        return sig;
+    }
+
+    // The entry header of one layout, the size mode and the optional fields are
+    // fixed at compile time. Scans pick the codec once (withHeaderCodec), so the
+    // loop over the entries has no branches on the layout.
+    template<SizeMode M, bool Crc, bool FrontCoded>
+    struct HeaderCodec {
+        static_assert(hasHeaders(M));
+        static constexpr SizeMode sizeMode = M;
+        static constexpr bool writeCrc = Crc;
+        static constexpr bool frontCoded = FrontCoded;
+        // of the longest header, shared size + name size + name + crc + size field
+        static constexpr uint64_t maxSize = (FrontCoded ? BYTE : 0) + BYTE + 0xff + (Crc ? DWORD : 0) +
+                                            (M == SizeMode16 ? WORD : M == SizeMode32 ? DWORD :
+                                             M == SizeMode64 ? QWORD : VARINT_MAX);
+
+        // Parses the header at offset and moves offset behind it, dataOffset is left
+        // to the caller. Throws std::out_of_range if the header is cut off.
+        static constexpr ParsedEntry parse(std::span<const uint8_t> data, uint64_t &offset) {
+            ParsedEntry entry{0, 0, 0, offset, 0, 0};
+            if constexpr (FrontCoded)
+                entry.sharedSize = parseField<uint8_t>(data, offset++);
+            entry.nameSize = parseField<uint8_t>(data, offset);
+            entry.nameOffset = offset + BYTE;
+            offset += BYTE + entry.nameSize;
+
+            if constexpr (Crc) {
+                entry.crc = parseField<uint32_t>(data, offset);
+                offset += DWORD;
+            }
+
+            if constexpr (M == SizeMode16) {
+                entry.size = parseField<uint16_t>(data, offset);
+                offset += WORD;
+            } else if constexpr (M == SizeMode32) {
+                entry.size = parseField<uint32_t>(data, offset);
+                offset += DWORD;
+            } else if constexpr (M == SizeMode64) {
+                entry.size = parseField<uint64_t>(data, offset);
+                offset += QWORD;
+            } else {
+                entry.size = parseVarint(data, offset);
+            }
+            return entry;
+        }
+    };
+
+    // Calls f(HeaderCodec<...>{}) with the codec of the layout and returns its result.
+    template<typename F>
+    constexpr decltype(auto) withHeaderCodec(SizeMode sizeMode, bool writeCrc, bool frontCoded, F &&f) {
+        auto fields = [&]<SizeMode M>() -> decltype(auto) {
+            if (writeCrc && frontCoded)
+                return f(HeaderCodec<M, true, true>{});
+            if (writeCrc)
+                return f(HeaderCodec<M, true, false>{});
+            if (frontCoded)
+                return f(HeaderCodec<M, false, true>{});
+            return f(HeaderCodec<M, false, false>{});
+        };
+
+        switch (sizeMode) {
+            case SizeMode16:
+                return fields.template operator()<SizeMode16>();
+            case SizeMode32:
+                return fields.template operator()<SizeMode32>();
+            case SizeMode64:
+                return fields.template operator()<SizeMode64>();
+            case SizeModeVarint:
+                return fields.template operator()<SizeModeVarint>();
+            default:
+                throw std::logic_error("Records have no header");
+        }
+    }
+
+    template<typename F>
+    constexpr decltype(auto) withHeaderCodec(const ParsedSignature &sig, F &&f) {
+        return withHeaderCodec(sig.sizeMode, sig.writeCrc, sig.frontCoded, std::forward<F>(f));
+    }
+
+    // Parses the header at offset with Codec and moves offset behind the payload.
+    template<typename Codec>
+    constexpr ParsedEntry parseEntryWith(std::span<const uint8_t> data, const ParsedSignature &sig, uint64_t &offset) {
+        ParsedEntry entry = Codec::parse(data, offset);
+        entry.dataOffset = sig.align(offset);
+        if (entry.dataOffset > data.size() || entry.size > data.size() - entry.dataOffset)
+            throw std::out_of_range("Unexpected end of archive");
+        offset = entry.dataOffset + entry.size;
+        return entry;
+    }
+
+    // Parses the header at offset (see hasHeaders) and moves offset behind the payload.
+    // Loops over many entries should pick the codec once, see forEachEntry.
+    constexpr ParsedEntry parseEntry(std::span<const uint8_t> data, const ParsedSignature &sig, uint64_t &offset) {
+        return withHeaderCodec(sig, [&]<typename Codec>(Codec) { return parseEntryWith<Codec>(data, sig, offset); });
+    }
+
+    // Parses the record table row at row (SizeModeFixed) and moves row to the next one.
+    constexpr void parseTableRow(std::span<const uint8_t> data, const ParsedSignature &sig, uint64_t &row,
+                                 ParsedEntry &entry) {
+        entry.nameSize = parseField<uint8_t>(data, row);
+        entry.nameOffset = row + BYTE;
+        row += BYTE + entry.nameSize;
+        if (row > data.size())
+            throw std::out_of_range("Unexpected end of the record table");
+
+        if (sig.writeCrc) {
+            entry.crc = parseField<uint32_t>(data, row);
+            row += DWORD;
+        }
+    }
+
+    // Calls f(const ParsedEntry&) for every entry, in archive order.
+    template<typename F>
+    constexpr void forEachEntry(std::span<const uint8_t> data, const ParsedSignature &sig, F &&f) {
+        if (sig.sizeMode == SizeModeColumns) {
+            // fileCount sizes, crcs (if any) and name sizes, then the names
+            if (sig.fileCount > data.size() || (sig.fileCount > 0 && sig.tableOffset == 0))
+                throw std::out_of_range("Unexpected end of the columns");
+            uint64_t sizes = sig.tableOffset;
+            uint64_t crcs = sizes + sig.fileCount * QWORD;
+            uint64_t nameSizes = crcs + (sig.writeCrc ? sig.fileCount * DWORD : 0);
+            uint64_t name = nameSizes + sig.fileCount;
+
+            uint64_t offset = sig.align(sig.dataStart);
+            for (uint64_t i = 0; i < sig.fileCount; i++) {
+                ParsedEntry entry{name, parseField<uint8_t>(data, nameSizes + i), 0, offset, offset,
+                                  parseField<uint64_t>(data, sizes + i * QWORD)};
+                if (sig.writeCrc)
+                    entry.crc = parseField<uint32_t>(data, crcs + i * DWORD);
+                name += entry.nameSize;
+                if (name > data.size() || offset > sig.tableOffset || entry.size > sig.tableOffset - offset)
+                    throw std::out_of_range("Unexpected end of archive");
+
+                f(entry);
+                offset = sig.align(offset + entry.size);
+            }
+            return;
+        }
+
+        if (sig.sizeMode != SizeModeFixed) {
+            withHeaderCodec(sig, [&]<typename Codec>(Codec) {
+                uint64_t offset = sig.dataStart;
+                for (uint64_t i = 0; i < sig.fileCount; i++)
+                    f(parseEntryWith<Codec>(data, sig, offset));
+            });
+            return;
+        }
+
+        uint64_t stride = sig.align(sig.recordSize);
+        uint64_t base = sig.align(sig.dataStart);
+        if (sig.fileCount > 0) {
+            uint64_t available = base <= data.size() ? data.size() - base : 0;
+            if (base > data.size() || (stride != 0 && sig.fileCount - 1 > available / stride) ||
+                (sig.fileCount - 1) * stride + sig.recordSize > available)
+                throw std::out_of_range("Unexpected end of archive");
+        }
+
+        uint64_t row = sig.tableOffset;
+        for (uint64_t i = 0; i < sig.fileCount; i++) {
+            uint64_t offset = base + i * stride;
+            ParsedEntry entry{0, 0, 0, offset, offset, sig.recordSize};
+            if (sig.tableOffset != 0)
+                parseTableRow(data, sig, row, entry);
+            f(entry);
+        }
+    }
+
+    // Walks every entry and returns their number, throws if the archive is malformed.
+    constexpr uint64_t validateArchive(std::span<const uint8_t> data) {
+        ParsedSignature sig = parseSignature(data);
+        uint64_t count = 0;
+        forEachEntry(data, sig, [&count](const ParsedEntry &) { count++; });
+        return count;
+    }
+
+    // Throws for front coded names that continue the previous name.
+    constexpr bool nameEquals(std::span<const uint8_t> data, const ParsedEntry &entry, std::string_view name) {
+        if (entry.sharedSize != 0)
+            throw std::logic_error("The name depends on the previous entry");
+        if (entry.nameSize != name.size())
+            return false;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (data[entry.nameOffset + i] != (uint8_t)name[i])
+                return false;
+        }
+        return true;
+    }
+
+    // All entries of an archive of N entries, e.g. a table baked into the binary:
+    //   constexpr auto entries = parseEntries<validateArchive(data)>(data);
+    template<size_t N>
+    constexpr std::array<ParsedEntry, N> parseEntries(std::span<const uint8_t> data) {
+        ParsedSignature sig = parseSignature(data);
+        if (sig.fileCount != N)
+            throw std::invalid_argument("Archive has a different number of entries");
+
+        std::array<ParsedEntry, N> out{};
+        size_t i = 0;
+        forEachEntry(data, sig, [&out, &i](const ParsedEntry &entry) { out[i++] = entry; });
+        return out;
+    }
+
+    // Throws an EntryNotFoundException if no entry is called name.
+    constexpr ParsedEntry findParsedEntry(std::span<const uint8_t> data, std::span<const ParsedEntry> entries,
+                                          std::string_view name) {
+        for (const ParsedEntry &entry : entries) {
+            if (nameEquals(data, entry, name))
+                return entry;
+        }
+        throw EntryNotFoundException(std::string(name));
+    }
+
+    // Header of the name index: seed, bucket, slot, key, block and collision count
+    // (u64 each), then the bit widths of displacements, key blocks, block offsets
+    // and block bytes (u8 each) and padding. Packed arrays (see putPacked) follow:
+    //   displacements[buckets], used slots (a bit per slot, u64 words),
+    //   u64 used slots in front of every STATIC_INDEX_RANK_SLOTS slots,
+    //   u8 fingerprints[keys] (padded to u64), key blocks[keys],
+    //   u64 anchors (every STATIC_INDEX_ANCHOR-th block offset),
+    //   block offsets[blocks] (relative to their anchor), block bytes[blocks],
+    //   u64 collisions[collisions]
+    // The hash maps a name to a slot, the used slots in front of it (its rank) to
+    // the fingerprint and block of the key. Block i holds the entries
+    // [i * STATIC_INDEX_BLOCK, (i + 1) * STATIC_INDEX_BLOCK), its offset is the
+    // header (or record) offset of its first entry. Collisions are sorted name
+    // hashes shared by different names, those names are left to a scan.
+    struct ParsedIndex {
+        uint64_t seed;
+        uint64_t buckets;
+        uint64_t slots;
+        uint64_t keys;
+        uint64_t blocks;
+        uint64_t collisions;
+        uint8_t displacementBits;
+        uint8_t blockBits;
+        uint8_t offsetBits;
+        uint8_t bytesBits;
+
+        [[nodiscard]] constexpr uint64_t getUsedOffset() const noexcept {
+            return STATIC_INDEX_HEADER_SIZE + packedSize(buckets, displacementBits);
+        }
+        [[nodiscard]] constexpr uint64_t getRankOffset() const noexcept {
+            return getUsedOffset() + packedSize(slots, 1);
+        }
+        [[nodiscard]] constexpr uint64_t getFingerprintOffset() const noexcept {
+            return getRankOffset() + (slots + STATIC_INDEX_RANK_SLOTS - 1) / STATIC_INDEX_RANK_SLOTS * QWORD;
+        }
+        [[nodiscard]] constexpr uint64_t getKeyBlockOffset() const noexcept {
+            return getFingerprintOffset() + packedSize(keys, 8);
+        }
+        [[nodiscard]] constexpr uint64_t getAnchorOffset() const noexcept {
+            return getKeyBlockOffset() + packedSize(keys, blockBits);
+        }
+        [[nodiscard]] constexpr uint64_t getBlockOffset() const noexcept {
+            return getAnchorOffset() + (blocks + STATIC_INDEX_ANCHOR - 1) / STATIC_INDEX_ANCHOR * QWORD;
+        }
+        [[nodiscard]] constexpr uint64_t getBlockBytesOffset() const noexcept {
+            return getBlockOffset() + packedSize(blocks, offsetBits);
+        }
+        [[nodiscard]] constexpr uint64_t getCollisionOffset() const noexcept {
+            return getBlockBytesOffset() + packedSize(blocks, bytesBits);
+        }
+        [[nodiscard]] constexpr uint64_t getSize() const noexcept {
+            return getCollisionOffset() + collisions * QWORD;
+        }
+    };
+
+    // the hash of a name the index is built over, seedHash gives the one of a seed
+    constexpr uint64_t indexKey(std::string_view name) noexcept {
+        return hashName(name, 0);
+    }
+
+    constexpr uint8_t indexFingerprint(uint64_t hash) noexcept {
+        return (uint8_t)hash;
+    }
+
+    // index is the section starting at the index offset of the signature
+    constexpr ParsedIndex parseIndex(std::span<const uint8_t> index) {
+        ParsedIndex parsed{parseField<uint64_t>(index, 0), parseField<uint64_t>(index, 8), parseField<uint64_t>(index, 16),
+                           parseField<uint64_t>(index, 24), parseField<uint64_t>(index, 32), parseField<uint64_t>(index, 40),
+                           parseField<uint8_t>(index, 48), parseField<uint8_t>(index, 49), parseField<uint8_t>(index, 50),
+                           parseField<uint8_t>(index, 51)};
+        // bounds the counts first, so the section offsets cannot overflow
+        uint64_t bits = index.size() * 8;
+        if (parsed.buckets == 0 || parsed.slots > bits || parsed.buckets > std::max<uint64_t>(1, parsed.slots) ||
+            parsed.keys > parsed.slots || parsed.blocks > bits || parsed.collisions > index.size() / QWORD ||
+            parsed.displacementBits > 32 || parsed.blockBits > 64 || parsed.offsetBits > 64 || parsed.bytesBits > 64 ||
+            parsed.getSize() > index.size())
+            throw std::out_of_range("Unexpected end of the index");
+        return parsed;
+    }
+
+    // true if name shares its hash with another name, the index cannot tell them apart
+    constexpr bool indexCollides(std::span<const uint8_t> index, const ParsedIndex &parsed, std::string_view name) {
+        uint64_t key = indexKey(name);
+        uint64_t low = 0, high = parsed.collisions;
+        while (low < high) {
+            uint64_t middle = low + (high - low) / 2;
+            uint64_t collision = parseField<uint64_t>(index, parsed.getCollisionOffset() + middle * QWORD);
+            if (collision == key)
+                return true;
+            if (collision < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return false;
+    }
+
+    // The block of the only entry that may be called name. The caller has to
+    // compare the names inside the block, unless the name is known to be contained.
+    // Names reported by indexCollides are not in the hash.
+    constexpr std::optional<uint64_t> probeIndex(std::span<const uint8_t> index, const ParsedIndex &parsed,
+                                                 std::string_view name) {
+        if (parsed.keys == 0)
+            return std::nullopt;
+
+        uint64_t h = seedHash(indexKey(name), parsed.seed);
+        uint64_t displacement = parsePacked(index, STATIC_INDEX_HEADER_SIZE, reduceHash(h, parsed.buckets),
+                                            parsed.displacementBits);
+        uint64_t slot = perfectHashSlot(h, (uint32_t)displacement, parsed.slots);
+
+        // the rank of a used slot counts the used slots in front of it
+        uint64_t word = parseField<uint64_t>(index, parsed.getUsedOffset() + slot / 64 * QWORD);
+        if ((word >> (slot % 64) & 1) == 0)
+            return std::nullopt;
+        uint64_t rank = parseField<uint64_t>(index, parsed.getRankOffset() + slot / STATIC_INDEX_RANK_SLOTS * QWORD);
+        for (uint64_t i = slot / STATIC_INDEX_RANK_SLOTS * STATIC_INDEX_RANK_SLOTS / 64; i < slot / 64; i++)
+            rank += std::popcount(parseField<uint64_t>(index, parsed.getUsedOffset() + i * QWORD));
+        rank += std::popcount(word & ((1ull << (slot % 64)) - 1));
+        if (rank >= parsed.keys)
+            throw std::out_of_range("Index slot out of range");
+
+        if (parseField<uint8_t>(index, parsed.getFingerprintOffset() + rank) != indexFingerprint(h))
+            return std::nullopt;
+        uint64_t block = parsePacked(index, parsed.getKeyBlockOffset(), rank, parsed.blockBits);
+        if (block >= parsed.blocks)
+            throw std::out_of_range("Index block out of range");
+        return block;
+    }
+
+    // where block starts, relative to the archive start
+    constexpr uint64_t indexBlockOffset(std::span<const uint8_t> index, const ParsedIndex &parsed, uint64_t block) {
+        return parseField<uint64_t>(index, parsed.getAnchorOffset() + block / STATIC_INDEX_ANCHOR * QWORD) +
+               parsePacked(index, parsed.getBlockOffset(), block, parsed.offsetBits);
+    }
+
+    // payload bytes of the entries of block
+    constexpr uint64_t indexBlockBytes(std::span<const uint8_t> index, const ParsedIndex &parsed, uint64_t block) {
+        return parsePacked(index, parsed.getBlockBytesOffset(), block, parsed.bytesBits);
+    }
+}
+
+#endif //STATICARCHIVE_PARSE_H
@@ -0,0 +1,111 @@
+
+#include "phash.h++"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+using namespace Static;
+
+
+// average amount of names per bucket, more makes the table smaller but the build slower
+#define STATIC_PHASH_BUCKET_LOAD 4
+// in a minimal hash the last buckets need about `slots` tries to hit one of the few free slots
+#define STATIC_PHASH_MIN_DISPLACEMENT 0x100000
+#define STATIC_PHASH_DISPLACEMENT_FACTOR 16
+#define STATIC_PHASH_MAX_SEEDS 64
+
+
+// hashes are the ones of the current seed
+static bool tryBuild(std::span<const uint64_t> hashes, PerfectHash &hash) {
+    size_t bucketCount = std::max<size_t>(1, (hashes.size() + STATIC_PHASH_BUCKET_LOAD - 1) / STATIC_PHASH_BUCKET_LOAD);
+    hash.displacements.assign(bucketCount, 0);
+
+    // the hashes grouped by bucket, bucket b holds grouped[starts[b], starts[b + 1])
+    std::vector<uint64_t> starts(bucketCount + 1, 0);
+    for (uint64_t h : hashes)
+        starts[reduceHash(h, bucketCount) + 1]++;
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    std::vector<uint64_t> grouped(hashes.size());
+    std::vector<uint64_t> fill(starts.begin(), starts.end() - 1);
+    for (uint64_t h : hashes)
+        grouped[fill[reduceHash(h, bucketCount)]++] = h;
+    fill = {};
+
+    // the big buckets are placed while there is still room
+    std::vector<size_t> order(bucketCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&starts](size_t a, size_t b) {
+        return starts[a + 1] - starts[a] > starts[b + 1] - starts[b];
+    });
+
+    uint64_t maxDisplacement = std::min<uint64_t>(std::max<uint64_t>(STATIC_PHASH_MIN_DISPLACEMENT,
+                                                                      hash.slots * STATIC_PHASH_DISPLACEMENT_FACTOR),
+                                                  UINT32_MAX);
+    std::vector<bool> taken(hash.slots, false);
+    std::vector<uint64_t> slots;
+    for (size_t bucket : order) {
+        std::span<const uint64_t> members(grouped.data() + starts[bucket], starts[bucket + 1] - starts[bucket]);
+        if (members.empty())
+            break;
+
+        bool placed = false;
+        for (uint64_t d = 0; d < maxDisplacement && !placed; d++) {
+            slots.clear();
+            placed = true;
+            for (uint64_t h : members) {
+                uint64_t slot = perfectHashSlot(h, (uint32_t)d, hash.slots);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+
+            if (placed) {
+                hash.displacements[bucket] = (uint32_t)d;
+                for (uint64_t slot : slots)
+                    taken[slot] = true;
+            }
+        }
+
+        if (!placed)
+            return false;
+    }
+    return true;
+}
+
+PerfectHash Static::buildPerfectHash(std::span<const std::string_view> names) {
+    std::vector<std::string_view> sorted(names.begin(), names.end());
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        throw std::invalid_argument("A perfect hash needs distinct names");
+
+    PerfectHash hash;
+    hash.slots = names.size();
+    std::vector<uint64_t> hashes(names.size());
+    for (hash.seed = 0; hash.seed < STATIC_PHASH_MAX_SEEDS; hash.seed++) {
+        for (size_t i = 0; i < names.size(); i++)
+            hashes[i] = hashName(names[i], hash.seed);
+        if (tryBuild(hashes, hash))
+            return hash;
+    }
+    throw std::runtime_error("Could not build a perfect hash");
+}
+
+PerfectHash Static::buildPerfectHash(std::span<const uint64_t> keys, double load) {
+    if (!(load > 0 && load <= 1))
+        throw std::invalid_argument("The load of a perfect hash is in (0, 1]");
+
+    PerfectHash hash;
+    hash.slots = (uint64_t)std::ceil((double)keys.size() / load);
+    std::vector<uint64_t> hashes(keys.size());
+    for (hash.seed = 0; hash.seed < STATIC_PHASH_MAX_SEEDS; hash.seed++) {
+        for (size_t i = 0; i < keys.size(); i++)
+            hashes[i] = seedHash(keys[i], hash.seed);
+        if (tryBuild(hashes, hash))
+            return hash;
+    }
+    throw std::runtime_error("Could not build a perfect hash");
+}
@@ -0,0 +1,81 @@
+
+#ifndef STATICARCHIVE_PHASH_H
+#define STATICARCHIVE_PHASH_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Static {
+
+    // murmur3 finalizer
+    constexpr uint64_t mixHash(uint64_t h) noexcept {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccd;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // FNV-1a with a murmur finalizer, so neighbouring seeds give unrelated values.
+    // constexpr, so lookups into generated tables can happen at compile time.
+    constexpr uint64_t hashName(std::string_view name, uint64_t seed) noexcept {
+        uint64_t h = 0xcbf29ce484222325 ^ (seed * 0x9e3779b97f4a7c15);
+        for (char c : name) {
+            h ^= (uint8_t)c;
+            h *= 0x100000001b3;
+        }
+        return mixHash(h);
+    }
+
+    // Rehashes a precomputed name hash for a seed, so a perfect hash can be built
+    // over name hashes without keeping the names.
+    constexpr uint64_t seedHash(uint64_t key, uint64_t seed) noexcept {
+        return mixHash(key ^ (seed * 0x9e3779b97f4a7c15));
+    }
+
+    // maps x uniformly onto [0, range)
+    constexpr uint64_t reduceHash(uint64_t x, uint64_t range) noexcept {
+        return (uint64_t)(((__uint128_t)x * range) >> 64);
+    }
+
+    // Minimal perfect hash in the hash-and-displace style (CHD): a name hashes to
+    // a bucket and its slot is the hash remixed with d, the displacement found for
+    // the bucket at build time. Every name of the build set gets its own
+    // slot in [0, slots), any other name lands on an arbitrary slot, so callers have
+    // to compare the name stored there. Built over names the hash is minimal (as many
+    // slots as names), built over keys some slots stay free, see buildPerfectHash.
+    struct PerfectHash {
+        uint64_t seed = 0;
+        uint64_t slots = 0;
+        std::vector<uint32_t> displacements; // one per bucket
+    };
+
+    constexpr uint64_t perfectHashSlot(uint64_t h, uint32_t displacement, uint64_t slots) noexcept {
+        return reduceHash(mixHash(h ^ (((uint64_t)displacement + 1) * 0x9e3779b97f4a7c15)), slots);
+    }
+
+    constexpr uint64_t perfectHashSlot(std::string_view name, uint64_t seed, uint64_t slots,
+                                       std::span<const uint32_t> displacements) noexcept {
+        if (slots == 0 || displacements.empty())
+            return 0;
+
+        uint64_t h = hashName(name, seed);
+        return perfectHashSlot(h, displacements[reduceHash(h, displacements.size())], slots);
+    }
+
+    inline uint64_t perfectHashSlot(std::string_view name, const PerfectHash &hash) noexcept {
+        return perfectHashSlot(name, hash.seed, hash.slots, hash.displacements);
+    }
+
+    // Throws std::invalid_argument if names contains duplicates.
+    PerfectHash buildPerfectHash(std::span<const std::string_view> names);
+    // Over distinct keys (name hashes), the slot of a key is perfectHashSlot of
+    // seedHash(key, seed). load is the share of used slots, below 1 the last
+    // buckets find a free slot in a few tries instead of about `slots`.
+    PerfectHash buildPerfectHash(std::span<const uint64_t> keys, double load);
+}
+
+#endif //STATICARCHIVE_PHASH_H
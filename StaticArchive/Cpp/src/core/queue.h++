@@ -0,0 +1,99 @@
+
+#ifndef STATICARCHIVE_QUEUE_H
+#define STATICARCHIVE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace Static {
+
+    // Bounded multi producer / multi consumer queue without locks (D. Vyukov's
+    // design). Every slot carries a sequence number telling producers and
+    // consumers whose turn it is, so they only contend on the two counters.
+    template<typename T>
+    class BoundedQueue {
+    public:
+        // the capacity is rounded up to a power of two
+        explicit BoundedQueue(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+
+            mask = size - 1;
+            slots = std::make_unique<Slot[]>(size);
+            for (size_t i = 0; i < size; i++)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        // Returns false if the queue is full, value is left untouched then.
+        bool tryPush(T &value) {
+            size_t position = tail.load(std::memory_order_relaxed);
+            Slot *slot;
+
+            while (true) {
+                slot = &slots[position & mask];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                auto diff = (intptr_t)sequence - (intptr_t)position;
+
+                if (diff == 0) {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = tail.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->value = std::move(value);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Returns false if the queue is empty.
+        bool tryPop(T &out) {
+            size_t position = head.load(std::memory_order_relaxed);
+            Slot *slot;
+
+            while (true) {
+                slot = &slots[position & mask];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                auto diff = (intptr_t)sequence - (intptr_t)(position + 1);
+
+                if (diff == 0) {
+                    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    position = head.load(std::memory_order_relaxed);
+                }
+            }
+
+            out = std::move(slot->value);
+            slot->sequence.store(position + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] size_t getCapacity() const noexcept { return mask + 1; }
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        // producers and consumers work on separate cache lines
+        alignas(64) std::atomic<size_t> tail{0};
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::unique_ptr<Slot[]> slots;
+        size_t mask;
+    };
+}
+
+#endif //STATICARCHIVE_QUEUE_H
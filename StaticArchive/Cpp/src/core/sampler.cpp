@@ -0,0 +1,142 @@
+
+#include "sampler.h++"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+using namespace Static;
+
+
+// unbiased enough for shuffling and, unlike std::uniform_int_distribution,
+// identical on every standard library
+static inline uint64_t bounded(std::mt19937_64 &rng, uint64_t bound) {
+    return (uint64_t)(((__uint128_t)rng() * bound) >> 64);
+}
+
+template<typename It>
+static void shuffle(It begin, It end, std::mt19937_64 &rng) {
+    for (auto i = end - begin; i > 1; i--)
+        std::swap(begin[i - 1], begin[bounded(rng, i)]);
+}
+
+std::vector<size_t> Static::shuffleOrder(size_t count, uint64_t seed, uint64_t epoch, size_t blockSize) {
+    std::mt19937_64 rng(seed ^ (epoch * 0x9e3779b97f4a7c15));
+
+    std::vector<size_t> indices(count);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    if (blockSize <= 1) {
+        shuffle(indices.begin(), indices.end(), rng);
+        return indices;
+    }
+
+    std::vector<size_t> blocks((count + blockSize - 1) / blockSize);
+    std::iota(blocks.begin(), blocks.end(), 0);
+    shuffle(blocks.begin(), blocks.end(), rng);
+
+    std::vector<size_t> order;
+    order.reserve(count);
+    for (size_t block : blocks) {
+        size_t begin = block * blockSize;
+        size_t end = std::min(begin + blockSize, count);
+        order.insert(order.end(), indices.begin() + begin, indices.begin() + end);
+        shuffle(order.end() - (end - begin), order.end(), rng);
+    }
+    return order;
+}
+
+Sampler::Sampler(StaticArchive &archive, std::vector<FileInfo> files, uint64_t seed, uint64_t epoch,
+                 size_t prefetch, size_t blockSize) : archive(archive), prefetch(prefetch) {
+    // blocks are formed from neighbours inside the archive
+    std::stable_sort(files.begin(), files.end(), [](const FileInfo &a, const FileInfo &b) {
+        return a.dataOffset < b.dataOffset;
+    });
+
+    order.reserve(files.size());
+    for (size_t i : shuffleOrder(files.size(), seed, epoch, blockSize))
+        order.push_back(files[i]);
+
+    if (archive.getPositionalReads())
+        plan.emplace(archive.getAccessPlan(order));
+
+    if (prefetch > 0 && archive.getPositionalReads())
+        worker = std::thread(&Sampler::prefetchLoop, this);
+}
+
+Sampler::~Sampler() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    cond.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+bool Sampler::next(Sample &out) {
+    if (position >= order.size())
+        return false;
+    if (plan)
+        plan->advance(position);
+
+    if (!worker.joinable()) {
+        out.info = order[position++];
+        archive.read(out.info, out.data);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    cond.wait(guard, [this] { return !ready.empty() || error; });
+    if (ready.empty())
+        std::rethrow_exception(error);
+
+    out.info = order[position++];
+    out.data = std::move(ready.front());
+    ready.pop_front();
+
+    guard.unlock();
+    cond.notify_all();
+    return true;
+}
+
+const std::vector<FileInfo> &Sampler::getOrder() const noexcept { return order; }
+
+uint64_t Sampler::getPosition() const noexcept { return position; }
+
+void Sampler::prefetchLoop() {
+    size_t produced = 0;
+    std::vector<FileInfo> batch;
+    std::vector<std::string> data;
+
+    while (produced < order.size()) {
+        size_t count;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait(guard, [this] { return stopping || ready.size() < prefetch; });
+            if (stopping)
+                return;
+            count = std::min(prefetch - ready.size(), order.size() - produced);
+        }
+
+        // the whole window goes through the read planner, so neighbours are merged
+        batch.assign(order.begin() + (long)produced, order.begin() + (long)(produced + count));
+        try {
+            archive.read(batch, data);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            error = std::current_exception();
+            cond.notify_all();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (std::string &sample : data)
+                ready.push_back(std::move(sample));
+        }
+        produced += count;
+        cond.notify_all();
+    }
+}
@@ -0,0 +1,63 @@
+
+#ifndef STATICARCHIVE_SAMPLER_H
+#define STATICARCHIVE_SAMPLER_H
+
+#include "static.h++"
+#include "advise.h++"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace Static {
+
+    struct Sample {
+        FileInfo info;
+        std::string data;
+    };
+
+    // Deterministic Fisher-Yates permutation of [0, count) for the given seed and
+    // epoch. With a blockSize > 1 the indices are cut into windows of blockSize
+    // neighbours, the windows are shuffled and so are the indices inside each window.
+    std::vector<size_t> shuffleOrder(size_t count, uint64_t seed, uint64_t epoch, size_t blockSize = 0);
+
+    // Delivers every entry of an archive once, in shuffled order. The payloads of
+    // the next `prefetch` samples are read on a background thread, which requires an
+    // archive opened read-only from a path (see getPositionalReads). Otherwise the
+    // samples are read on demand by next(). The shuffled order is also handed
+    // to the kernel as an AccessPlan.
+    class Sampler {
+    public:
+        Sampler(StaticArchive &archive, std::vector<FileInfo> files, uint64_t seed, uint64_t epoch,
+                size_t prefetch = 8, size_t blockSize = 0);
+        Sampler(const Sampler &) = delete;
+        Sampler &operator=(const Sampler &) = delete;
+        ~Sampler();
+
+        // Moves the next sample into out, returns false once the epoch is exhausted.
+        bool next(Sample &out);
+
+        [[nodiscard]] const std::vector<FileInfo> &getOrder() const noexcept;
+        [[nodiscard]] uint64_t getPosition() const noexcept;
+    private:
+        void prefetchLoop();
+
+        StaticArchive &archive;
+        std::vector<FileInfo> order;
+        size_t prefetch;
+        uint64_t position = 0;
+        std::optional<AccessPlan> plan;
+
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<std::string> ready;
+        std::exception_ptr error;
+        bool stopping = false;
+    };
+}
+
+#endif //STATICARCHIVE_SAMPLER_H
@@ -0,0 +1,63 @@
+
+#include "schedule.h++"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace Static;
+
+
+std::vector<ReadRun> Static::planReads(std::span<const FileInfo> files, uint64_t maxGap, uint64_t maxRun) {
+    std::vector<size_t> order(files.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&files](size_t a, size_t b) {
+        return files[a].dataOffset < files[b].dataOffset;
+    });
+
+    std::vector<ReadRun> runs;
+    for (size_t i : order) {
+        const FileInfo &file = files[i];
+        uint64_t end = file.dataOffset + file.size;
+
+        if (!runs.empty()) {
+            ReadRun &run = runs.back();
+            uint64_t runEnd = run.offset + run.size;
+            uint64_t mergedEnd = std::max(runEnd, end);
+
+            if (file.dataOffset <= runEnd + maxGap && mergedEnd - run.offset <= maxRun) {
+                run.size = mergedEnd - run.offset;
+                run.members.push_back(i);
+                continue;
+            }
+        }
+
+        runs.push_back(ReadRun{file.dataOffset, file.size, {i}});
+    }
+    return runs;
+}
+
+std::vector<Shard> Static::planShards(const std::vector<FileInfo> &files, size_t count, uint64_t granularity) {
+    std::vector<Shard> shards;
+    if (count == 0)
+        return shards;
+
+    uint64_t begin = files.empty() ? 0 : files.front().offset;
+    uint64_t total = files.empty() ? 0 : files.back().dataOffset + files.back().size - begin;
+
+    size_t entry = 0;
+    for (size_t i = 0; i < count; i++) {
+        // (i + 1) / count of the range, without overflowing on huge archives
+        uint64_t target = begin + total / count * (i + 1) + total % count * (i + 1) / count;
+        Shard shard{entry, 0, entry < files.size() ? files[entry].offset : begin + total, 0, 0};
+        shard.end = shard.offset;
+
+        while (entry < files.size() && (shard.end < target || entry % granularity != 0 || i + 1 == count)) {
+            const FileInfo &file = files[entry++];
+            shard.count++;
+            shard.bytes += file.size;
+            shard.end = file.dataOffset + file.size;
+        }
+        shards.push_back(shard);
+    }
+    return shards;
+}
@@ -0,0 +1,34 @@
+
+#ifndef STATICARCHIVE_SCHEDULE_H
+#define STATICARCHIVE_SCHEDULE_H
+
+#include "static.h++"
+
+#include <span>
+
+namespace Static {
+
+    // A single read covering the payloads of one or more requested entries.
+    struct ReadRun {
+        uint64_t offset;
+        uint64_t size;
+        std::vector<size_t> members; // indices into the requested files, in offset order
+    };
+
+    // Sorts the requested files by their position inside the archive and
+    // merges neighbouring payloads into runs. Entries separated by less than
+    // maxGap bytes (their headers) end up in the same run, unless the run
+    // would grow beyond maxRun. An entry bigger than maxRun gets its own run.
+    std::vector<ReadRun> planReads(std::span<const FileInfo> files,
+                                   uint64_t maxGap = STATIC_MERGE_GAP,
+                                   uint64_t maxRun = STATIC_MAX_RUN);
+
+    // Cuts the files (in archive order) into `count` contiguous shards. A shard
+    // ends at the first entry that reaches its share of the total byte range,
+    // headers included, as that is what a reader of the shard has to fetch.
+    // Shards may be empty if there are fewer entries than shards. Shards only
+    // start at entries whose index is a multiple of granularity.
+    std::vector<Shard> planShards(const std::vector<FileInfo>& files, size_t count, uint64_t granularity = 1);
+}
+
+#endif //STATICARCHIVE_SCHEDULE_H
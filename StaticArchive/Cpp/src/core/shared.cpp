@@ -0,0 +1,84 @@
+
+#include "shared.h++"
+
+#include <fcntl.h>
+
+using namespace Static;
+
+
+std::shared_ptr<const SharedArchive> SharedArchive::open(const std::string &path, uint8_t flags) {
+    return std::make_shared<const SharedArchive>(path, flags);
+}
+
+SharedArchive::SharedArchive(const std::string &path, uint8_t flags) : file(path, O_RDONLY) {
+    // the listing goes through a regular reader, which is closed again right away
+    StaticArchive archive(path, ModeRead, SizeMode64, flags);
+    archive.getFileInfos(infos);
+    checks = archive.checks;
+    sizeMode = archive.getSizeMode();
+    baseOffset = archive.getBaseOffset();
+    writeCrc = archive.getWriteCrc();
+
+    // try_emplace keeps the first of several entries with the same name, like a scan
+    names.reserve(infos.size());
+    for (size_t i = 0; i < infos.size(); i++)
+        names.try_emplace(infos[i].name, i);
+}
+
+std::span<const FileInfo> SharedArchive::getFileInfos() const noexcept { return infos; }
+
+const FileInfo &SharedArchive::getFileInfo(std::string_view name) const {
+    const FileInfo *info = findFileInfo(name);
+    if (info == nullptr)
+        throw EntryNotFoundException(std::string(name));
+    return *info;
+}
+
+const FileInfo *SharedArchive::findFileInfo(std::string_view name) const noexcept {
+    auto it = names.find(name);
+    return it == names.end() ? nullptr : &infos[it->second];
+}
+
+uint64_t SharedArchive::read(const FileInfo &info, char *out) const {
+    if (file.read(info.dataOffset, out, info.size) != info.size)
+        throw std::ios_base::failure("Unexpected end of archive");
+    verify(info, out);
+    return info.size;
+}
+
+void SharedArchive::verify(const FileInfo &info, const char *data) const {
+    if (checks && writeCrc)
+        checkCrc(info.name, info.crc, data, info.size);
+}
+
+SizeMode SharedArchive::getSizeMode() const noexcept { return sizeMode; }
+
+uint64_t SharedArchive::getFileCount() const noexcept { return infos.size(); }
+
+uint64_t SharedArchive::getBaseOffset() const noexcept { return baseOffset; }
+
+bool SharedArchive::getWriteCrc() const noexcept { return writeCrc; }
+
+bool SharedArchive::getChecks() const noexcept { return checks; }
+
+
+ArchiveCursor::ArchiveCursor(std::shared_ptr<const SharedArchive> archive) : archive(std::move(archive)) {}
+
+std::span<const char> ArchiveCursor::read(const FileInfo &file) {
+    // grows to the largest payload read so far and stays there
+    if (buffer.size() < file.size)
+        buffer.resize(file.size);
+    archive->read(file, buffer.data());
+    return {buffer.data(), file.size};
+}
+
+std::span<const char> ArchiveCursor::read(std::string_view name) {
+    return read(archive->getFileInfo(name));
+}
+
+uint64_t ArchiveCursor::read(const FileInfo &file, std::string &out) const {
+    out.resize(file.size);
+    return archive->read(file, out.data());
+}
+
+const SharedArchive &ArchiveCursor::getArchive() const noexcept { return *archive; }
@@ -0,0 +1,82 @@
+
+#ifndef STATICARCHIVE_SHARED_H
+#define STATICARCHIVE_SHARED_H
+
+#include "static.h++"
+
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace Static {
+
+    class ArchiveCursor;
+
+    // Read-only archive for many threads. The entry table and a name lookup are
+    // built once when it is opened and never change afterwards, payloads are read
+    // with positional reads on one descriptor. All methods are const and may be
+    // called concurrently, so one instance per process is enough:
+    //
+    //   std::shared_ptr<const SharedArchive> archive = SharedArchive::open(path);
+    //   // on every thread
+    //   ArchiveCursor cursor(archive);
+    //   std::span<const char> data = cursor.read("name");
+    class SharedArchive {
+    public:
+        // Opens the archive (or the one attached to path, see attachArchive). The
+        // flags are the ones of a reading StaticArchive, STATIC_FLAG_DISABLE_CHECKS
+        // skips the signature checks and the crcs of the payloads.
+        static std::shared_ptr<const SharedArchive> open(const std::string &path, uint8_t flags = 0);
+
+        // Use open, the name lookup points into the entry table, so instances do not move.
+        SharedArchive(const std::string &path, uint8_t flags);
+        SharedArchive(const SharedArchive &) = delete;
+        SharedArchive &operator=(const SharedArchive &) = delete;
+
+        [[nodiscard]] std::span<const FileInfo> getFileInfos() const noexcept;
+        // The first entry with that name, throws an EntryNotFoundException.
+        const FileInfo &getFileInfo(std::string_view name) const;
+        // nullptr if there is no entry with that name
+        [[nodiscard]] const FileInfo *findFileInfo(std::string_view name) const noexcept;
+
+        // Reads the payload into out, which must hold file.size bytes, and verifies it.
+        uint64_t read(const FileInfo &file, char *out) const;
+        // Same as StaticArchive::verify.
+        void verify(const FileInfo &file, const char *data) const;
+
+        [[nodiscard]] SizeMode getSizeMode() const noexcept;
+        [[nodiscard]] uint64_t getFileCount() const noexcept;
+        [[nodiscard]] uint64_t getBaseOffset() const noexcept;
+        [[nodiscard]] bool getWriteCrc() const noexcept;
+        [[nodiscard]] bool getChecks() const noexcept;
+    private:
+        File file;
+        std::vector<FileInfo> infos;
+        std::unordered_map<std::string_view, size_t> names;
+        SizeMode sizeMode;
+        uint64_t baseOffset;
+        bool writeCrc;
+        bool checks;
+    };
+
+    // The per thread part of a SharedArchive: a reference to it and a scratch
+    // buffer, which is reused by every read. Cheap to create, but not to be
+    // shared between threads.
+    class ArchiveCursor {
+    public:
+        explicit ArchiveCursor(std::shared_ptr<const SharedArchive> archive);
+
+        // The payload of file, valid until the next read of this cursor.
+        std::span<const char> read(const FileInfo &file);
+        std::span<const char> read(std::string_view name);
+        uint64_t read(const FileInfo &file, std::string &out) const;
+
+        [[nodiscard]] const SharedArchive &getArchive() const noexcept;
+    private:
+        std::shared_ptr<const SharedArchive> archive;
+        std::vector<char> buffer;
+    };
+}
+
+#endif //STATICARCHIVE_SHARED_H
@@ -2,38 +2,69 @@
 #include "static.h++"
 #include "static.h"
 #include "helpers.h++"
+#include "schedule.h++"
+#include "sampler.h++"
+#include "advise.h++"
+#include "parse.h++"
+#include "phash.h++"
+#include "locate.h++"
 
+#include <algorithm>
+#include <numeric>
 #include <fstream>
 #include <cstring>
+#include <filesystem>
+#include <zlib.h>
+#include <fcntl.h>
+#include <thread>
 
 using namespace Static;
+namespace fs = std::filesystem;
 
 
 
 // C functions and root level functions
 bool Static::is_archive(const char *path) {
+    std::ifstream file(path, std::ifstream::binary);
+    if (!file.is_open())
+        return false;
 
+    uint8_t magic[QWORD] = STATIC_MAGIC;
+    uint8_t buffer[QWORD];
+
+    file.read((char*)&buffer, QWORD);
+    return file.gcount() == QWORD && memcmp(&magic, &buffer, QWORD) == 0;
+}
+
+void Static::checkCrc(std::string_view name, uint32_t expected, const void *data, uint64_t size) {
+    uint32_t crc = crc32_z(crc32(0, nullptr, 0), (const Bytef*)data, size);
+    if (crc != expected)
+        throw ChecksumMismatchException(std::string(name), expected, crc);
 }
 
 // Public methods
 StaticArchive::StaticArchive(const std::string &path) {
     setup(path, ModeRead, SizeMode64);
+    init();
 }
 
 StaticArchive::StaticArchive(const std::string &path, Mode mode) {
     setup(path, mode, SizeMode64);
+    init();
 }
 
 StaticArchive::StaticArchive(const std::string &path, Mode mode, SizeMode sizeMode) {
     setup(path, mode, sizeMode);
+    init();
 }
 
 StaticArchive::StaticArchive(const std::string &path, Mode mode, SizeMode sizeMode, uint8_t flags) {
-    setup(path, mode, sizeMode);
-
     Flags flags_{flags};
-    checks = flags_.f.checks;
+    checks = !flags_.f.disableChecks;
     writeCrc = flags_.f.writeCrc;
+
+    setup(path, mode, sizeMode);
+    init();
 }
 
 StaticArchive::StaticArchive(std::fstream *stream, Mode mode, SizeMode sizeMode, uint8_t flags) {
@@ -42,49 +73,642 @@ StaticArchive::StaticArchive(std::fstream *stream, Mode mode, SizeMode sizeMode,
     this->sizeMode = sizeMode;
 
     Flags flags_{flags};
-    checks = flags_.f.checks;
+    checks = !flags_.f.disableChecks;
+    writeCrc = flags_.f.writeCrc;
+    init();
+}
+
+StaticArchive::StaticArchive(const std::string &path, Mode mode, const Options &options) {
+    if (options.alignment == 0 || (options.alignment & (options.alignment - 1)) != 0)
+        throw std::invalid_argument("The alignment must be a power of two");
+
+    Flags flags_{options.flags};
+    checks = !flags_.f.disableChecks;
     writeCrc = flags_.f.writeCrc;
+    recordSize = options.recordSize;
+    alignment = options.alignment;
+    indexed = options.index;
+    frontCoded = options.frontCodedNames;
+    durability = options.durability;
+    syncBytes = options.syncBytes;
+    syncInterval = options.syncInterval;
+    legacySignature = options.legacySignature;
+    if (frontCoded && !hasHeaders(options.sizeMode))
+        throw std::invalid_argument("Entries have no headers to front code");
+    if (legacySignature && (!hasHeaders(options.sizeMode) || alignment > 1 || indexed || frontCoded ||
+                            durability != DurabilityNone))
+        throw std::invalid_argument("These options need the signature extension");
+
+    setup(path, mode, options.sizeMode);
+    init();
+    // appended archives only know their size mode now
+    if (durability != DurabilityNone && !hasHeaders(sizeMode))
+        throw std::invalid_argument("Archives without headers cannot commit");
+}
+
+StaticArchive::StaticArchive(const std::string &path, uint64_t baseOffset) {
+    this->baseOffset = baseOffset;
+    setup(path, ModeRead, SizeMode64);
+    init();
+}
+
+StaticArchive::~StaticArchive() {
+    // destructors must not throw, close() explicitly to see the errors
+    if (!closed) {
+        try {
+            close();
+        } catch (...) {}
+    }
+}
+
+FileInfo StaticArchive::append(const std::string &name, std::basic_ios<uint8_t> &stream) {
+    return appendStreambuf(name, stream.rdbuf());
+}
+
+uint64_t StaticArchive::read(FileInfo file, std::string &out) {
+    out.resize(file.size);
+    readInto(file, out.data());
+    return file.size;
+}
+
+uint64_t StaticArchive::read(FileInfo file, std::basic_ios<uint8_t> &stream) {
+    std::vector<char> buffer(std::min<uint64_t>(file.size, STATIC_BUFFER_SIZE));
+    uint32_t crc = crc32(0, nullptr, 0);
+
+    uint64_t done = 0;
+    while (done < file.size) {
+        uint64_t ns = std::min<uint64_t>(file.size - done, buffer.size());
+        readRange(file.dataOffset + done, buffer.data(), ns);
+        crc = crc32_z(crc, (const Bytef*)buffer.data(), (size_t)ns);
+        stream.rdbuf()->sputn((const uint8_t*)buffer.data(), (std::streamsize)ns);
+        done += ns;
+    }
+
+    if (checks && writeCrc && crc != file.crc)
+        throw ChecksumMismatchException(file.name, file.crc, crc);
+    return done;
 }
 
-template<typename T>
-FileInfo StaticArchive::append(const std::string &name, T *data) {}
-FileInfo StaticArchive::append(const std::string &name, std::basic_ios<uint8_t> &stream) {}
+uint64_t StaticArchive::read(const std::vector<FileInfo> &files, std::vector<std::string> &out) {
+    out.resize(files.size());
+
+    uint64_t total = 0;
+    std::vector<char> buffer;
+    for (const ReadRun &run : planReads(files)) {
+        if (run.members.size() == 1) {
+            total += read(files[run.members[0]], out[run.members[0]]);
+            continue;
+        }
+
+        buffer.resize(run.size);
+        readRange(run.offset, buffer.data(), run.size);
+
+        for (size_t i : run.members) {
+            const FileInfo &file = files[i];
+            const char *data = buffer.data() + (file.dataOffset - run.offset);
+            verify(file, data);
+            out[i].assign(data, file.size);
+            total += file.size;
+        }
+    }
+    return total;
+}
+
+uint64_t StaticArchive::readBatch(std::span<const FileInfo> files, std::span<const std::span<char>> buffers,
+                                  unsigned threads) {
+    if (buffers.size() < files.size())
+        throw std::invalid_argument("Not enough buffers for the batch");
+    for (size_t i = 0; i < files.size(); i++) {
+        if (buffers[i].size() < files[i].size)
+            throw std::invalid_argument("Buffer too small for " + files[i].name);
+    }
+
+    uint64_t total = 0;
+    if (archiveFile.isOpen()) {
+        if (isWriteable())
+            stream->flush();
+
+        // the headers between merged payloads are read into a scratch buffer
+        std::vector<char> sink(STATIC_MERGE_GAP);
+        std::vector<iovec> segments;
+        std::vector<std::pair<size_t, size_t>> duplicates;
+
+        for (const ReadRun &run : planReads(files)) {
+            segments.clear();
+            uint64_t cursor = run.offset;
+            size_t previous = run.members.front();
+
+            for (size_t i : run.members) {
+                const FileInfo &file = files[i];
+                if (file.dataOffset < cursor) {
+                    // requested more than once, copied after the read
+                    duplicates.emplace_back(i, previous);
+                    continue;
+                }
+                if (file.dataOffset > cursor)
+                    segments.push_back(iovec{sink.data(), file.dataOffset - cursor});
+                if (file.size > 0)
+                    segments.push_back(iovec{buffers[i].data(), file.size});
+
+                cursor = file.dataOffset + file.size;
+                previous = i;
+            }
+
+            if (archiveFile.read(run.offset, segments) != run.size)
+                throw std::ios_base::failure("Unexpected end of archive");
+        }
+
+        for (const auto &[target, source] : duplicates)
+            std::copy_n(buffers[source].data(), files[target].size, buffers[target].data());
+    } else {
+        for (size_t i = 0; i < files.size(); i++)
+            readRange(files[i].dataOffset, buffers[i].data(), files[i].size);
+    }
+
+    for (const FileInfo &file : files)
+        total += file.size;
+
+    if (!checks || !writeCrc || threads == 0 || files.empty())
+        return total;
+
+    // each thread checks every n-th file, the first failure is rethrown
+    threads = std::min<unsigned>(threads, files.size());
+    std::vector<std::exception_ptr> errors(threads);
+    auto verifyPart = [&](unsigned part) {
+        try {
+            for (size_t i = part; i < files.size(); i += threads)
+                verify(files[i], buffers[i].data());
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned part = 1; part < threads; part++)
+        workers.emplace_back(verifyPart, part);
+    verifyPart(0);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    for (std::exception_ptr &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    return total;
+}
+
+std::unique_ptr<Sampler> StaticArchive::sampler(uint64_t seed, uint64_t epoch, size_t prefetch, size_t blockSize) {
+    std::vector<FileInfo> infos;
+    getFileInfos(infos);
+    return std::make_unique<Sampler>(*this, std::move(infos), seed, epoch, prefetch, blockSize);
+}
+
+AccessPlan StaticArchive::getAccessPlan(std::vector<FileInfo> order, uint64_t window) {
+    if (isWriteable())
+        stream->flush();
+    return AccessPlan(archiveFile, std::move(order), window);
+}
+
+AddResult StaticArchive::add(std::string path, uint8_t flags) {
+    if (!isWriteable())
+        throw ReadOnlyException();
+
+    Flags flags_{flags};
+    std::vector<std::pair<fs::path, std::string>> targets;
+
+    bool isFile = fs::is_regular_file(path);
+    // names are relative to what was added, a single file keeps its file name
+    if (isFile) {
+        targets.emplace_back(path, fs::path(path).filename().string());
+    } else if (fs::is_directory(path)) {
+        for (const fs::directory_entry &entry : fs::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file())
+                targets.emplace_back(entry.path(), fs::relative(entry.path(), path).string());
+        }
+    }
+
+    if (flags_.f.onlyNames) {
+        for (auto &[target, name] : targets)
+            name = target.filename().string();
+    }
+
+    // inputs which cannot be stat'ed fail when they are appended
+    std::vector<uint64_t> sizes;
+    sizes.reserve(targets.size());
+    for (const auto &[target, name] : targets) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(target, ec);
+        sizes.push_back(ec ? 0 : size);
+    }
+    uint64_t largest = sizes.empty() ? 0 : *std::max_element(sizes.begin(), sizes.end());
+
+    bool resizable = sizeMode == SizeMode16 || sizeMode == SizeMode32 || sizeMode == SizeMode64;
+    if (flags_.f.autoSizeMode && fileCount == 0 && resizable && sizeMode != fittingSizeMode(largest)) {
+        sizeMode = fittingSizeMode(largest);
+        writeSignature();
+    }
+    if (largest > getMaxFilesize() && !flags_.f.ignoreErrors)
+        throw InvalidDataSizeException(largest);
+
+    AddResult result{{}, sizeMode, 0, 0};
+    for (size_t i = 0; i < targets.size(); i++) {
+        result.headerBytes += getHeaderSize(targets[i].second, sizes[i]);
+        result.dataBytes += sizes[i];
+    }
+
+    if (flags_.f.preallocate && archiveFile.isOpen()) {
+        stream->flush();
+        archiveFile.preallocate(fs::file_size(this->path), result.headerBytes + result.dataBytes, true);
+    }
+
+    for (const auto &[target, name] : targets) {
+        try {
+            std::ifstream input(target, std::ifstream::binary);
+            result.files.push_back(appendStreambuf(name, input.rdbuf()));
+        } catch (std::exception &e) {
+            if (flags_.f.verbose)
+                std::cerr << "Error while appending file " << target << " \"" << e.what() << "\"\n";
+            if (!flags_.f.ignoreErrors)
+                throw;
+        }
+    }
+    return result;
+}
+
+void StaticArchive::extract(std::string path, uint8_t flags) {
+    std::vector<FileInfo> infos;
+    getFileInfos(infos);
+    extract(std::move(path), infos, flags);
+}
+
+void StaticArchive::extract(std::string path, std::vector<FileInfo> &names, uint8_t flags) {
+    if (!fs::is_directory(path))
+        throw fs::filesystem_error("Target does not exist or is not a directory", path,
+                                   std::make_error_code(std::errc::not_a_directory));
+
+    Flags flags_{flags};
+    std::vector<char> buffer;
+
+    // the final size is known up front, so the output gets its extents in one go
+    auto openTarget = [&path](const FileInfo &file) {
+        // names come from the archive, an absolute one or one climbing out with ".."
+        // would write anywhere
+        fs::path name = fs::path(file.name).lexically_normal();
+        if (name.empty() || name.has_root_path() || name == "." || *name.begin() == "..")
+            throw UnsafeNameException(file.name);
+        fs::path target = fs::path(path) / name;
+        fs::create_directories(target.parent_path());
+
+        File out(target.string(), O_WRONLY | O_CREAT | O_TRUNC);
+        out.preallocate(0, file.size);
+        return out;
+    };
+
+    for (const ReadRun &run : planReads(names)) {
+        try {
+            // a single entry is streamed, so big files never have to fit into memory
+            if (run.members.size() == 1) {
+                const FileInfo &file = names[run.members[0]];
+                File out = openTarget(file);
+                buffer.resize(std::min<uint64_t>(file.size, STATIC_BUFFER_SIZE));
+                uint32_t crc = crc32(0, nullptr, 0);
+
+                for (uint64_t done = 0; done < file.size;) {
+                    uint64_t ns = std::min<uint64_t>(file.size - done, buffer.size());
+                    readRange(file.dataOffset + done, buffer.data(), ns);
+                    crc = crc32_z(crc, (const Bytef*)buffer.data(), (size_t)ns);
+                    out.write(buffer.data(), ns);
+                    done += ns;
+                }
+
+                if (checks && writeCrc && crc != file.crc)
+                    throw ChecksumMismatchException(file.name, file.crc, crc);
+                continue;
+            }
+
+            buffer.resize(run.size);
+            readRange(run.offset, buffer.data(), run.size);
+
+            for (size_t i : run.members) {
+                const FileInfo &file = names[i];
+                const char *data = buffer.data() + (file.dataOffset - run.offset);
+                verify(file, data);
+                openTarget(file).write(data, file.size);
+            }
+        } catch (std::exception &e) {
+            if (flags_.f.verbose)
+                std::cerr << "Error while extracting \"" << e.what() << "\"\n";
+            if (!flags_.f.ignoreErrors)
+                throw;
+        }
+    }
+}
+
+FileInfo StaticArchive::getFileInfo(std::string name) {
+    if (indexOffset != 0 && archiveFile.isOpen()) {
+        std::span<const uint8_t> index = getIndex();
+        ParsedIndex parsed = parseIndex(index);
+        if (!indexCollides(index, parsed, name)) {
+            std::optional<uint64_t> block = probeIndex(index, parsed, name);
+
+            // the block holds the first entry of that name
+            uint64_t first = block ? *block * STATIC_INDEX_BLOCK : fileCount;
+            if (first < fileCount) {
+                std::vector<FileInfo> infos;
+                getFileInfos(Shard{first, std::min<uint64_t>(STATIC_INDEX_BLOCK, fileCount - first),
+                                   baseOffset + indexBlockOffset(index, parsed, *block), 0, 0}, infos);
+                for (FileInfo &info : infos) {
+                    if (info.name == name)
+                        return std::move(info);
+                }
+            }
+            throw EntryNotFoundException(std::move(name));
+        }
+    }
+
+    std::vector<FileInfo> infos;
+    getFileInfos(infos);
+
+    for (FileInfo &info : infos) {
+        if (info.name == name)
+            return std::move(info);
+    }
+    throw EntryNotFoundException(std::move(name));
+}
+
+void StaticArchive::getFileInfos(std::vector<FileInfo> &out) {
+    getFileInfos(Shard{0, fileCount, dataStart, 0, 0}, out);
+}
+
+void StaticArchive::getFileInfos(const Shard &shard, std::vector<FileInfo> &out) {
+    if (!hasHeaders(sizeMode)) {
+        out.reserve(out.size() + shard.count);
+        for (uint64_t i = shard.firstEntry; i < shard.firstEntry + shard.count; i++)
+            out.push_back(getRecordInfo(i));
+        return;
+    }
+
+    out.reserve(out.size() + shard.count);
+    withHeaderCodec(sizeMode, writeCrc, frontCoded, [&]<typename Codec>(Codec) {
+        scanHeaders<Codec>(shard, out);
+    });
+}
+
+template<typename Codec>
+void StaticArchive::scanHeaders(const Shard &shard, std::vector<FileInfo> &out) {
+    std::vector<uint8_t> window;
+    uint64_t windowOffset = 0;
+    bool windowAtEnd = false;
+
+    // shards of front coded archives start at restart entries (see getShards)
+    std::string previous;
+    uint64_t offset = shard.offset;
+    for (uint64_t i = 0; i < shard.count; i++) {
+        uint64_t windowEnd = windowOffset + window.size();
+        if (offset < windowOffset || offset >= windowEnd || (offset + Codec::maxSize > windowEnd && !windowAtEnd)) {
+            window.resize(STATIC_SCAN_WINDOW);
+            window.resize(readUpTo(offset, (char*)window.data(), window.size()));
+            windowOffset = offset;
+            windowAtEnd = window.size() < STATIC_SCAN_WINDOW;
+        }
+
+        uint64_t at = offset - windowOffset;
+        ParsedEntry entry;
+        try {
+            entry = Codec::parse(window, at);
+        } catch (std::out_of_range &) {
+            throw std::ios_base::failure("Unexpected end of archive");
+        }
+
+        const char *suffix = (const char*)window.data() + entry.nameOffset;
+        std::string name;
+        if constexpr (Codec::frontCoded) {
+            name.assign(previous, 0, entry.sharedSize);
+            name.append(suffix, entry.nameSize);
+            previous = name;
+        } else {
+            name.assign(suffix, entry.nameSize);
+        }
+
+        uint64_t dataOffset = align(windowOffset + at);
+        out.push_back(FileInfo{std::move(name), entry.size, entry.crc, offset, dataOffset});
+        offset = dataOffset + entry.size;
+    }
+}
+
+FileInfo StaticArchive::getRecordInfo(uint64_t index) const {
+    if (hasHeaders(sizeMode))
+        throw std::logic_error("Records are only addressable in archives without headers");
+    if (index >= fileCount)
+        throw std::out_of_range("Record index out of range");
+
+    if (sizeMode == SizeModeColumns)
+        return FileInfo{recordNames[index], columnSizes[index], recordCrcs[index],
+                        columnOffsets[index], columnOffsets[index]};
+
+    uint64_t offset = getRecordBase() + index * getRecordStride();
+    bool named = index < recordNames.size() && !recordNames[index].empty();
+    return FileInfo{named ? recordNames[index] : std::to_string(index),
+                    recordSize,
+                    index < recordCrcs.size() ? recordCrcs[index] : 0,
+                    offset, offset};
+}
+
+std::vector<Shard> StaticArchive::getShards(size_t count) {
+    if (indexOffset == 0 || entriesEnd == 0 || !archiveFile.isOpen() || !hasHeaders(sizeMode)) {
+        std::vector<FileInfo> infos;
+        getFileInfos(infos);
+        return planShards(infos, count, frontCoded ? STATIC_NAME_RESTART : 1);
+    }
+
+    // Same cuts as planShards at block granularity, but the blocks of the index
+    // tell where they start, so no header is read. Headers follow the payload in
+    // front of them directly, a block ends where the next one starts.
+    std::span<const uint8_t> index = getIndex();
+    ParsedIndex parsed = parseIndex(index);
+    auto blockStart = [&](uint64_t block) {
+        return block < parsed.blocks ? baseOffset + indexBlockOffset(index, parsed, block) : entriesEnd;
+    };
+
+    std::vector<Shard> shards;
+    uint64_t begin = blockStart(0);
+    uint64_t total = entriesEnd - begin;
+    uint64_t block = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t target = begin + total / count * (i + 1) + total % count * (i + 1) / count;
+        uint64_t first = std::min<uint64_t>(block * STATIC_INDEX_BLOCK, fileCount);
+        Shard shard{first, 0, blockStart(block), 0, 0};
+        shard.end = shard.offset;
+
+        while (block < parsed.blocks && (shard.end < target || i + 1 == count)) {
+            shard.count += std::min<uint64_t>(STATIC_INDEX_BLOCK, fileCount - block * STATIC_INDEX_BLOCK);
+            shard.bytes += indexBlockBytes(index, parsed, block);
+            shard.end = blockStart(++block);
+        }
+        shards.push_back(shard);
+    }
+    return shards;
+}
+
+void StaticArchive::getFileNames(std::vector<std::string> &out) {
+    std::vector<FileInfo> infos;
+    getFileInfos(infos);
+
+    out.reserve(out.size() + infos.size());
+    for (FileInfo &info : infos)
+        out.push_back(std::move(info.name));
+}
+
+bool StaticArchive::isReadable() const { return true; }
+
+bool StaticArchive::isWriteable() const { return mode != ModeRead; }
+
+FileInfo StaticArchive::getFileInfoAt(uint64_t offset) {
+    if (sizeMode == SizeModeFixed)
+        return getRecordInfo((offset - getRecordBase()) / std::max<uint64_t>(getRecordStride(), 1));
+
+    std::vector<FileInfo> out;
+    getFileInfos(Shard{0, 1, offset, 0, 0}, out);
+    return std::move(out.front());
+}
+
+void StaticArchive::flush() {
+    if (isWriteable()) {
+        writeTable();
+        writeSignature();
+    }
+    stream->flush();
+}
+
+void StaticArchive::commit() {
+    if (!isWriteable())
+        throw ReadOnlyException();
+    if (!archiveFile.isOpen())
+        throw std::logic_error("Committing needs a file path");
+    if (!hasHeaders(sizeMode))
+        throw std::logic_error("Archives without headers cannot commit, their table is overwritten by appends");
+
+    // a signature on disk never counts entries which are not
+    writeTable();
+    stream->flush();
+    archiveFile.sync();
+    writeSignature();
+    stream->flush();
+    archiveFile.sync();
+
+    pendingBytes = 0;
+    lastCommit = std::chrono::steady_clock::now();
+}
+
+void StaticArchive::close() {
+    if (isWriteable() && indexed)
+        writeIndex();
+    if (isWriteable() && durability != DurabilityNone)
+        commit();
+    else
+        flush();
+    if (ownedStream && stream->is_open())
+        stream->close();
+    archiveFile.close();
+    closed = true;
+}
 
 // Private Methods
 inline void StaticArchive::setup(const std::string &path, const Mode &mode_, const SizeMode &sizeMode_) {
-    stream = new std::fstream(path, std::fstream::binary | std::fstream::in | std::fstream::out);
+    std::ios_base::openmode openMode = std::fstream::binary | std::fstream::in;
+    if (mode_ == ModeAppend)
+        openMode |= std::fstream::out;
+    else if (mode_ == ModeCreate)
+        openMode |= std::fstream::out | std::fstream::trunc;
+
+    ownedStream = std::make_unique<std::fstream>(path, openMode);
+    stream = ownedStream.get();
+    if (!stream->is_open())
+        throw std::ios_base::failure("Could not open archive " + path);
+
+    this->path = path;
+    archiveFile = File(path, mode_ == ModeRead ? O_RDONLY : O_RDWR);
 
     mode = mode_;
     sizeMode = sizeMode_;
 }
 
+void StaticArchive::init() {
+    if (mode == ModeCreate) {
+        if (sizeMode == SizeModeFixed && recordSize == 0)
+            throw std::invalid_argument("Fixed size records need a record size");
+        // the extension records where the entries end, so appends start there right away
+        if (!legacySignature)
+            extensionSize = STATIC_EXTENSION_SIZE;
+        dataStart = STATIC_SIGNATURE_SIZE + (extensionSize ? DWORD + extensionSize : 0);
+        entriesEnd = dataStart;
+        writeSignature();
+        return;
+    }
+
+    if (!checkSignature()) {
+        // maybe attached to another file, the trailer tells where it starts
+        std::optional<ArchiveLocation> location;
+        if (mode == ModeRead && baseOffset == 0 && archiveFile.isOpen())
+            location = locateArchive(archiveFile);
+        if (location)
+            baseOffset = location->offset;
+        if (checks && !(location && checkSignature()))
+            throw InvalidSignatureException();
+    }
+    loadSignature();
+
+    if (sizeMode == SizeModeFixed)
+        loadRecordTable();
+    else if (sizeMode == SizeModeColumns)
+        loadColumns();
+    if (isWriteable() && indexOffset != 0)
+        dropIndex();
+    if (isWriteable())
+        findEntriesEnd();
+}
+
 bool StaticArchive::checkSignature() {
-    stream->seekg(0);
+    stream->clear();
+    stream->seekg((std::streamoff)baseOffset);
 
     uint8_t magic[QWORD] = STATIC_MAGIC;
     uint8_t buffer[QWORD];
 
     stream->read((char*)&buffer, QWORD);
-    return strncmp((char*)&magic, (char*)&buffer, QWORD);
+    return stream->gcount() == QWORD && memcmp(&magic, &buffer, QWORD) == 0;
 }
 
 void StaticArchive::loadSignature() {
-    stream->seekg(QWORD);
-
-    conv<uint32_t> gp{};
-    stream->read((char*)gp.data, DWORD);
-    generalPurposeField = gp.value;
-
-    conv<uint64_t> fc{};
-    stream->read((char*)gp.data, QWORD);
-    fileCount = fc.value;
+    // the first extension field is its size
+    std::vector<uint8_t> data(STATIC_SIGNATURE_SIZE + DWORD);
+    data.resize(readUpTo(baseOffset, (char*)data.data(), data.size()));
+    uint64_t size = parseSignatureSize(data);
+    if (size > data.size()) {
+        data.resize(size);
+        data.resize(readUpTo(baseOffset, (char*)data.data(), size));
+    }
 
-    sizeMode = (SizeMode)stream->get();
-    writeCrc = (bool)stream->get();
+    // the magic was checked (or skipped) by init
+    ParsedSignature sig = parseSignature(data, false);
+    generalPurposeField = sig.generalPurposeField;
+    fileCount = sig.fileCount;
+    sizeMode = sig.sizeMode;
+    writeCrc = sig.writeCrc;
+    frontCoded = sig.frontCoded;
+    extensionSize = sig.dataStart > STATIC_SIGNATURE_SIZE ? (uint32_t)(sig.dataStart - STATIC_SIGNATURE_SIZE - DWORD) : 0;
+    recordSize = sig.recordSize;
+    tableOffset = fromStored(sig.tableOffset);
+    alignment = sig.alignment;
+    indexOffset = fromStored(sig.indexOffset);
+    entriesEnd = fromStored(sig.entriesEnd);
+    indexed = indexOffset != 0;
+    dataStart = baseOffset + sig.dataStart;
 }
 
 void StaticArchive::writeSignature() {
-    stream->seekp(0);
+    stream->clear();
+    stream->seekp((std::streamoff)baseOffset);
 
     uint8_t magic[QWORD] = STATIC_MAGIC;
     stream->write((char*)&magic, QWORD);
@@ -96,66 +720,659 @@ void StaticArchive::writeSignature() {
     stream->write((char*)fc.data, QWORD);
 
     stream->put((char)sizeMode);
-    stream->put((char)writeCrc);
+    stream->put((char)((writeCrc ? STATIC_SIG_CRC : 0) | (extensionSize ? STATIC_SIG_EXTENDED : 0) |
+                       (frontCoded ? STATIC_SIG_FRONT_CODED : 0)));
+
+    if (extensionSize) {
+        std::vector<uint8_t> ext;
+        putField<uint64_t>(ext, recordSize);
+        putField<uint64_t>(ext, toStored(tableOffset));
+        putField<uint32_t>(ext, alignment);
+        putField<uint64_t>(ext, toStored(indexOffset));
+        putField<uint64_t>(ext, toStored(entriesEnd));
+
+        // the size is fixed at creation, fields of newer writers are left untouched
+        conv<uint32_t> es{extensionSize};
+        stream->write((char*)es.data, DWORD);
+        stream->write((char*)ext.data(), std::min<uint64_t>(extensionSize, ext.size()));
+    }
 }
 
-EntryHeader StaticArchive::readHeader() {
-    uint8_t ns = stream->get();
-    char* nameBuffer = new char[ns];
-    stream->read(nameBuffer, ns);
-    std::string name = nameBuffer;
-    delete[] nameBuffer;
+uint64_t StaticArchive::align(uint64_t offset) const noexcept {
+    // relative to the archive start, attached archives should start at a multiple
+    return baseOffset + ((offset - baseOffset + alignment - 1) & ~(uint64_t)(alignment - 1));
+}
 
-    conv<uint32_t> crc{};
-    stream->read((char*)&crc.data, DWORD);
+uint64_t StaticArchive::fromStored(uint64_t offset) const noexcept {
+    return offset ? baseOffset + offset : 0;
+}
 
-    uint64_t dataSize;
-    switch (sizeMode) {
-        case SizeMode64:
-        {
-            conv<uint64_t> ds{};
-            stream->read((char*)&ds.data, QWORD);
-            dataSize = ds.value;
-            break;
+uint64_t StaticArchive::toStored(uint64_t offset) const noexcept {
+    return offset ? offset - baseOffset : 0;
+}
+
+uint64_t StaticArchive::getRecordBase() const noexcept {
+    return align(dataStart);
+}
+
+uint64_t StaticArchive::getRecordStride() const noexcept {
+    return align(recordSize);
+}
+
+void StaticArchive::loadRecordTable() {
+    recordNames.clear();
+    recordCrcs.clear();
+    if (tableOffset == 0)
+        return;
+
+    stream->clear();
+    stream->seekg((std::streamoff)tableOffset);
+    recordNames.reserve(fileCount);
+    recordCrcs.reserve(fileCount);
+
+    for (uint64_t i = 0; i < fileCount; i++) {
+        uint8_t ns = stream->get();
+        std::string name(ns, '\0');
+        stream->read(name.data(), ns);
+
+        conv<uint32_t> crc{};
+        if (writeCrc)
+            stream->read((char*)&crc.data, DWORD);
+
+        recordNames.push_back(std::move(name));
+        recordCrcs.push_back(crc.value);
+    }
+
+    if (!*stream)
+        throw std::ios_base::failure("Unexpected end of the record table");
+}
+
+void StaticArchive::writeRecordTable() {
+    bool named = std::any_of(recordNames.begin(), recordNames.end(), [](const std::string &name) {
+        return !name.empty();
+    });
+
+    // the table lives behind the last record and is rewritten after appends
+    tableOffset = 0;
+    if (!writeCrc && !named)
+        return;
+
+    tableOffset = getRecordBase() + fileCount * getRecordStride();
+    stream->clear();
+    stream->seekp((std::streamoff)tableOffset);
+
+    for (uint64_t i = 0; i < fileCount; i++) {
+        const std::string &name = recordNames[i];
+        stream->put((char)name.size());
+        stream->write(name.c_str(), (int64_t)name.size());
+
+        if (writeCrc) {
+            conv<uint32_t> crc_conv{recordCrcs[i]};
+            stream->write((char*)&crc_conv.data, DWORD);
         }
-        case SizeMode32:
-        {
-            conv<uint32_t> ds{};
-            stream->read((char*)&ds.data, DWORD);
-            dataSize = ds.value;
-            break;
+    }
+}
+
+void StaticArchive::loadColumns() {
+    columnSizes.assign(fileCount, 0);
+    recordCrcs.assign(fileCount, 0);
+    recordNames.clear();
+    columnOffsets.clear();
+    if (fileCount == 0)
+        return;
+    if (tableOffset == 0)
+        throw std::ios_base::failure("Archive has no columns");
+
+    // every column is read with a single call
+    std::vector<uint8_t> nameSizes(fileCount);
+    stream->clear();
+    stream->seekg((std::streamoff)tableOffset);
+    stream->read((char*)columnSizes.data(), (std::streamsize)(fileCount * QWORD));
+    if (writeCrc)
+        stream->read((char*)recordCrcs.data(), (std::streamsize)(fileCount * DWORD));
+    stream->read((char*)nameSizes.data(), (std::streamsize)fileCount);
+
+    std::string names(std::accumulate(nameSizes.begin(), nameSizes.end(), (uint64_t)0), '\0');
+    stream->read(names.data(), (std::streamsize)names.size());
+    if (!*stream)
+        throw std::ios_base::failure("Unexpected end of the columns");
+
+    recordNames.reserve(fileCount);
+    for (uint64_t i = 0, at = 0; i < fileCount; at += nameSizes[i++])
+        recordNames.emplace_back(names, at, nameSizes[i]);
+
+    // payloads start at aligned offsets, so offset i is the sum of the aligned sizes in front
+    uint64_t mask = alignment - 1;
+    columnOffsets.resize(fileCount);
+    std::transform_exclusive_scan(columnSizes.begin(), columnSizes.end(), columnOffsets.begin(), getRecordBase(),
+                                  std::plus<>(), [mask](uint64_t size) { return (size + mask) & ~mask; });
+}
+
+void StaticArchive::writeColumns() {
+    // the columns live behind the last payload and are rewritten after appends
+    tableOffset = entriesEnd;
+    stream->clear();
+    stream->seekp((std::streamoff)tableOffset);
+    stream->write((const char*)columnSizes.data(), (std::streamsize)(fileCount * QWORD));
+    if (writeCrc)
+        stream->write((const char*)recordCrcs.data(), (std::streamsize)(fileCount * DWORD));
+
+    std::string nameSizes;
+    nameSizes.reserve(fileCount);
+    for (const std::string &name : recordNames)
+        nameSizes.push_back((char)name.size());
+    stream->write(nameSizes.data(), (std::streamsize)nameSizes.size());
+    for (const std::string &name : recordNames)
+        stream->write(name.data(), (std::streamsize)name.size());
+}
+
+void StaticArchive::writeTable() {
+    if (sizeMode == SizeModeFixed)
+        writeRecordTable();
+    else if (sizeMode == SizeModeColumns)
+        writeColumns();
+}
+
+template<typename F>
+uint64_t StaticArchive::scanBatches(F &&f) {
+    uint64_t end = dataStart;
+    std::vector<FileInfo> infos;
+    for (uint64_t first = 0; first < fileCount; first += STATIC_SCAN_BATCH) {
+        infos.clear();
+        getFileInfos(Shard{first, std::min<uint64_t>(STATIC_SCAN_BATCH, fileCount - first), end, 0, 0}, infos);
+        end = infos.back().dataOffset + infos.back().size;
+        f(infos);
+    }
+    return end;
+}
+
+void StaticArchive::writeIndex() {
+    // only the name hashes are kept, not the names
+    uint64_t blocks = (fileCount + STATIC_INDEX_BLOCK - 1) / STATIC_INDEX_BLOCK;
+    std::vector<std::pair<uint64_t, uint64_t>> keys; // name hash, entry
+    std::vector<uint64_t> blockOffsets, blockBytes;
+    keys.reserve(fileCount);
+    blockOffsets.reserve(blocks);
+    blockBytes.reserve(blocks);
+    scanBatches([&](const std::vector<FileInfo> &infos) {
+        for (const FileInfo &info : infos) {
+            if (keys.size() % STATIC_INDEX_BLOCK == 0) {
+                blockOffsets.push_back(info.offset - baseOffset);
+                blockBytes.push_back(0);
+            }
+            blockBytes.back() += info.size;
+            keys.emplace_back(indexKey(info.name), keys.size());
         }
-        case SizeMode16:
-        {
-            conv<uint16_t> ds{};
-            dataSize = ds.value;
-            stream->read((char*)&ds.data, WORD);
+    });
+
+    // the index goes behind everything else
+    uint64_t end;
+    if (sizeMode == SizeModeFixed) {
+        writeRecordTable();
+        end = tableOffset ? (uint64_t)stream->tellp() : getRecordBase() + fileCount * getRecordStride();
+    } else if (sizeMode == SizeModeColumns) {
+        writeColumns();
+        end = stream->tellp();
+    } else {
+        end = entriesEnd;
+    }
+
+    // Lookups by name find the first entry of that name, like the scan. Entries
+    // sharing a hash are read again: if their names differ, the hash goes to the
+    // collisions and its names are left to a scan.
+    auto nameOf = [&](uint64_t entry) {
+        uint64_t block = entry / STATIC_INDEX_BLOCK;
+        std::vector<FileInfo> infos;
+        getFileInfos(Shard{block * STATIC_INDEX_BLOCK, entry % STATIC_INDEX_BLOCK + 1,
+                           baseOffset + blockOffsets[block], 0, 0}, infos);
+        return std::move(infos.back().name);
+    };
+    std::sort(keys.begin(), keys.end());
+    std::vector<uint64_t> distinct, collisions;
+    for (size_t i = 0, next; i < keys.size(); i = next) {
+        for (next = i + 1; next < keys.size() && keys[next].first == keys[i].first;)
+            next++;
+        bool collides = false;
+        if (next - i > 1) {
+            std::string name = nameOf(keys[i].second);
+            for (size_t j = i + 1; j < next && !collides; j++)
+                collides = nameOf(keys[j].second) != name;
+        }
+        if (collides) {
+            collisions.push_back(keys[i].first);
+        } else {
+            keys[distinct.size()] = keys[i];
+            distinct.push_back(keys[i].first);
+        }
+    }
+    keys.resize(distinct.size());
+    PerfectHash hash = buildPerfectHash(distinct, STATIC_INDEX_LOAD);
+
+    // fingerprints and blocks are stored by the rank of their slot
+    std::vector<uint64_t> used((hash.slots + 63) / 64, 0);
+    std::vector<uint64_t> slots(distinct.size());
+    for (size_t i = 0; i < distinct.size(); i++) {
+        uint64_t h = seedHash(distinct[i], hash.seed);
+        slots[i] = perfectHashSlot(h, hash.displacements[reduceHash(h, hash.displacements.size())], hash.slots);
+        used[slots[i] / 64] |= 1ull << (slots[i] % 64);
+    }
+    std::vector<uint64_t> ranks((hash.slots + STATIC_INDEX_RANK_SLOTS - 1) / STATIC_INDEX_RANK_SLOTS);
+    for (uint64_t word = 0, rank = 0; word < used.size(); word++) {
+        if (word % (STATIC_INDEX_RANK_SLOTS / 64) == 0)
+            ranks[word / (STATIC_INDEX_RANK_SLOTS / 64)] = rank;
+        rank += std::popcount(used[word]);
+    }
+    std::vector<uint8_t> fingerprints(distinct.size());
+    std::vector<uint64_t> keyBlocks(distinct.size());
+    for (size_t i = 0; i < distinct.size(); i++) {
+        uint64_t slot = slots[i];
+        uint64_t rank = ranks[slot / STATIC_INDEX_RANK_SLOTS];
+        for (uint64_t word = slot / STATIC_INDEX_RANK_SLOTS * (STATIC_INDEX_RANK_SLOTS / 64); word < slot / 64; word++)
+            rank += std::popcount(used[word]);
+        rank += std::popcount(used[slot / 64] & ((1ull << (slot % 64)) - 1));
+        fingerprints[rank] = indexFingerprint(seedHash(distinct[i], hash.seed));
+        keyBlocks[rank] = keys[i].second / STATIC_INDEX_BLOCK;
+    }
+    slots = {};
+
+    // block offsets relative to their anchor
+    std::vector<uint64_t> anchors, blockDeltas(blocks);
+    for (uint64_t block = 0; block < blocks; block++) {
+        if (block % STATIC_INDEX_ANCHOR == 0)
+            anchors.push_back(blockOffsets[block]);
+        blockDeltas[block] = blockOffsets[block] - anchors.back();
+    }
+    auto widthOf = [](const std::vector<uint64_t> &values) {
+        return (uint8_t)std::bit_width(values.empty() ? 0 : *std::max_element(values.begin(), values.end()));
+    };
+    std::vector<uint64_t> displacements(hash.displacements.begin(), hash.displacements.end());
+
+    ParsedIndex parsed{hash.seed, displacements.size(), hash.slots, distinct.size(), blocks, collisions.size(),
+                       widthOf(displacements), (uint8_t)std::bit_width(blocks > 0 ? blocks - 1 : 0),
+                       widthOf(blockDeltas), widthOf(blockBytes)};
+    std::vector<uint8_t> index;
+    index.reserve(parsed.getSize());
+    for (uint64_t field : {parsed.seed, parsed.buckets, parsed.slots, parsed.keys, parsed.blocks, parsed.collisions})
+        putField<uint64_t>(index, field);
+    for (uint8_t bits : {parsed.displacementBits, parsed.blockBits, parsed.offsetBits, parsed.bytesBits})
+        putField<uint8_t>(index, bits);
+    index.resize(STATIC_INDEX_HEADER_SIZE, 0);
+    putPacked(index, displacements, parsed.displacementBits);
+    for (uint64_t word : used)
+        putField<uint64_t>(index, word);
+    for (uint64_t rank : ranks)
+        putField<uint64_t>(index, rank);
+    index.insert(index.end(), fingerprints.begin(), fingerprints.end());
+    index.resize(parsed.getKeyBlockOffset(), 0);
+    putPacked(index, keyBlocks, parsed.blockBits);
+    for (uint64_t anchor : anchors)
+        putField<uint64_t>(index, anchor);
+    putPacked(index, blockDeltas, parsed.offsetBits);
+    putPacked(index, blockBytes, parsed.bytesBits);
+    for (uint64_t collision : collisions)
+        putField<uint64_t>(index, collision);
+
+    stream->clear();
+    stream->seekp((std::streamoff)end);
+    stream->write((const char*)index.data(), (std::streamsize)index.size());
+    indexOffset = end;
+}
+
+void StaticArchive::findEntriesEnd() {
+    if (sizeMode == SizeModeFixed) {
+        entriesEnd = getRecordBase() + fileCount * getRecordStride();
+        return;
+    }
+    if (sizeMode == SizeModeColumns) {
+        entriesEnd = fileCount ? columnOffsets.back() + columnSizes.back() : dataStart;
+        return;
+    }
+
+    stream->clear();
+    stream->seekg(0, std::fstream::end);
+    uint64_t fileSize = stream->tellg();
+
+    // Without the field (no extension or an older writer) the signature is the
+    // only commit record, the entries it counts are scanned for their end. The
+    // batches start at restart entries, so the last name is complete for front
+    // coding. Anything behind the committed end belongs to a transaction which
+    // was not committed, so only that tail is scanned. Its first name may
+    // continue the last committed one, which is scanned for the same way.
+    bool continued = writeCrc && frontCoded && fileCount % STATIC_NAME_RESTART != 0;
+    if (entriesEnd == 0 || (continued && entriesEnd < fileSize)) {
+        uint64_t end = scanBatches([this](std::vector<FileInfo> &infos) {
+            lastName = std::move(infos.back().name);
+        });
+        if (entriesEnd == 0)
+            entriesEnd = end;
+    }
+    if (entriesEnd > fileSize)
+        throw std::ios_base::failure("Unexpected end of archive");
+    if (entriesEnd == fileSize)
+        return;
+
+    // Complete entries are kept if their crc matches, without crcs a torn payload
+    // looks like any other.
+    if (writeCrc) {
+        withHeaderCodec(sizeMode, writeCrc, frontCoded, [&]<typename Codec>(Codec) {
+            recoverEntries<Codec>(fileSize);
+        });
+    }
+
+    // whatever follows belongs to no entry
+    if (entriesEnd < fileSize && archiveFile.isOpen()) {
+        stream->flush();
+        archiveFile.truncate(entriesEnd);
+    }
+}
+
+template<typename Codec>
+void StaticArchive::recoverEntries(uint64_t fileSize) {
+    std::vector<uint8_t> header;
+    std::string previous = lastName;
+    while (entriesEnd < fileSize) {
+        header.resize(std::min<uint64_t>(Codec::maxSize, fileSize - entriesEnd));
+        header.resize(readUpTo(entriesEnd, (char*)header.data(), header.size()));
+
+        // a front coded name may continue the name of an entry before the commit
+        uint64_t at = 0;
+        ParsedEntry entry;
+        try {
+            entry = Codec::parse(header, at);
+        } catch (std::out_of_range &) {
             break;
         }
+        // zeroed space (an empty name) ends the scan as well
+        if (entry.sharedSize > previous.size() || entry.sharedSize + entry.nameSize == 0)
+            break;
+
+        uint64_t dataOffset = align(entriesEnd + at);
+        if (dataOffset > fileSize || entry.size > fileSize - dataOffset || !checkRange(dataOffset, entry.size, entry.crc))
+            break;
+
+        std::string name = previous.substr(0, entry.sharedSize);
+        name.append((const char*)header.data() + entry.nameOffset, entry.nameSize);
+        fileCount++;
+        entriesEnd = dataOffset + entry.size;
+        previous = lastName = std::move(name);
+    }
+}
+
+bool StaticArchive::checkRange(uint64_t offset, uint64_t size, uint32_t crc) {
+    std::vector<char> buffer(std::min<uint64_t>(size, STATIC_BUFFER_SIZE));
+    uint32_t actual = crc32(0, nullptr, 0);
+    for (uint64_t done = 0; done < size;) {
+        uint64_t ns = std::min<uint64_t>(size - done, buffer.size());
+        readRange(offset + done, buffer.data(), ns);
+        actual = crc32_z(actual, (const Bytef*)buffer.data(), (size_t)ns);
+        done += ns;
     }
+    return actual == crc;
+}
+
+void StaticArchive::commitPending(uint64_t bytes) {
+    pendingBytes += bytes;
+    if (durability != DurabilityPeriodic)
+        return;
+
+    bool limited = syncBytes != 0 || syncInterval.count() != 0;
+    if (!limited || (syncBytes != 0 && pendingBytes >= syncBytes) ||
+        (syncInterval.count() != 0 && std::chrono::steady_clock::now() - lastCommit >= syncInterval))
+        commit();
+}
 
-    EntryHeader hdr{std::move(name), crc.value, dataSize};
-    return hdr;
+std::span<const uint8_t> StaticArchive::getIndex() {
+    if (!indexMap.isOpen())
+        indexMap = Mapping(archiveFile, indexOffset, archiveFile.getSize() - indexOffset);
+    return indexMap.getData();
 }
 
-void StaticArchive::writeheader(std::string &name, uint32_t crc, uint64_t dataSize) noexcept(false) {
-    if (name.size() > 256)
+void StaticArchive::dropIndex() {
+    if (!archiveFile.isOpen())
+        throw std::logic_error("Appending to an indexed archive needs a file path");
+
+    // entries are appended where the index starts, it is rebuilt on close
+    uint64_t end = indexOffset;
+    indexOffset = 0;
+    writeSignature();
+    stream->flush();
+    archiveFile.truncate(end);
+}
+
+void StaticArchive::writeheader(const std::string &name, uint32_t crc, uint64_t dataSize) noexcept(false) {
+    std::vector<uint8_t> header;
+    putHeader(header, name, crc, dataSize);
+    stream->write((const char*)header.data(), (std::streamsize)header.size());
+}
+
+void StaticArchive::putHeader(std::vector<uint8_t> &out, const std::string &name, uint32_t crc, uint64_t dataSize) {
+    if (name.size() > 0xff)
         throw InvalidNameSizeException(name.size());
+    if (dataSize > getMaxFilesize())
+        throw InvalidDataSizeException(dataSize);
 
-    stream->put((char)name.size());
-    stream->write(name.c_str(), (int64_t)name.size());
+    size_t shared = 0;
+    if (frontCoded) {
+        // restart entries can be decoded without the entries in front
+        if (fileCount % STATIC_NAME_RESTART != 0) {
+            auto end = std::mismatch(name.begin(), name.end(), lastName.begin(), lastName.end()).first;
+            shared = end - name.begin();
+        }
+        out.push_back((uint8_t)shared);
+        lastName = name;
+    }
+
+    out.push_back((uint8_t)(name.size() - shared));
+    out.insert(out.end(), name.begin() + (std::ptrdiff_t)shared, name.end());
 
-    conv<uint32_t> crc_conv{crc};
-    stream->write((char*)&crc_conv.data, DWORD);
+    if (writeCrc)
+        putField<uint32_t>(out, crc);
+
+    if (sizeMode == SizeModeVarint) {
+        uint8_t varint[VARINT_MAX];
+        out.insert(out.end(), varint, varint + putVarint(varint, dataSize));
+        return;
+    }
 
     conv<uint64_t> ds{dataSize};
-    stream->write((char*)&ds.data, QWORD);
+    out.insert(out.end(), ds.data, ds.data + getSizeWidth(dataSize));
 }
 
-StaticArchive::~StaticArchive() {
-    if (stream->is_open())
-        stream->close();
-    delete stream;
+uint8_t StaticArchive::getSizeWidth(uint64_t dataSize) const noexcept {
+    switch (sizeMode) {
+        case SizeMode16:
+            return WORD;
+        case SizeMode32:
+            return DWORD;
+        case SizeMode64:
+            return QWORD;
+        case SizeModeFixed:
+            return 0;
+        case SizeModeVarint:
+            return varintSize(dataSize);
+        case SizeModeColumns:
+            // the field in the sizes column
+            return QWORD;
+    }
+    return 0;
+}
+
+uint64_t StaticArchive::getHeaderSize(const std::string &name, uint64_t dataSize) const noexcept {
+    if (sizeMode == SizeModeFixed)
+        return getRecordStride() - recordSize;
+    // worst case padding, the actual amount depends on the position
+    return (frontCoded ? WORD : BYTE) + name.size() + (writeCrc ? DWORD : 0) + getSizeWidth(dataSize) + alignment - 1;
+}
+
+void StaticArchive::writePadding(uint64_t size) {
+    static const char zeros[4096]{};
+    for (uint64_t ns; size > 0; size -= ns) {
+        ns = std::min<uint64_t>(size, sizeof(zeros));
+        stream->write(zeros, (std::streamsize)ns);
+    }
+}
+
+template<typename CharT>
+FileInfo StaticArchive::appendStreambuf(const std::string &name, std::basic_streambuf<CharT> *buf) {
+    if (!isWriteable())
+        throw ReadOnlyException();
+
+    // the size is taken from the remaining part of the source
+    auto start = buf->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+    auto end = buf->pubseekoff(0, std::ios_base::end, std::ios_base::in);
+    buf->pubseekpos(start, std::ios_base::in);
+    uint64_t dataSize = end - start;
+
+    stream->clear();
+    uint64_t offset;
+    if (sizeMode == SizeModeFixed) {
+        if (name.size() > 0xff)
+            throw InvalidNameSizeException(name.size());
+        if (dataSize != recordSize)
+            throw InvalidDataSizeException(dataSize);
+
+        // records are addressed by index, whatever follows them is the table
+        offset = getRecordBase() + fileCount * getRecordStride();
+        stream->seekp((std::streamoff)offset);
+    } else if (sizeMode == SizeModeColumns) {
+        if (name.size() > 0xff)
+            throw InvalidNameSizeException(name.size());
+
+        // the payloads are packed, the columns behind them are rewritten by flush
+        offset = align(entriesEnd);
+        stream->seekp((std::streamoff)entriesEnd);
+    } else {
+        offset = entriesEnd;
+        stream->seekp((std::streamoff)offset);
+        writeheader(name, 0, dataSize);
+    }
+    uint64_t headerEnd = stream->tellp();
+    uint64_t dataOffset = align(headerEnd);
+    writePadding(dataOffset - headerEnd);
+
+    std::vector<CharT> buffer(std::min<uint64_t>(dataSize, STATIC_BUFFER_SIZE));
+    uint32_t crc = crc32(0, nullptr, 0);
+
+    for (uint64_t done = 0; done < dataSize;) {
+        auto ns = buf->sgetn(buffer.data(), (std::streamsize)std::min<uint64_t>(dataSize - done, buffer.size()));
+        if (ns <= 0)
+            throw std::ios_base::failure("Unexpected end of input for " + name);
+
+        crc = crc32_z(crc, (const Bytef*)buffer.data(), (size_t)ns);
+        stream->write((const char*)buffer.data(), ns);
+        done += ns;
+    }
+
+    if (sizeMode == SizeModeFixed) {
+        writePadding(getRecordStride() - recordSize);
+    } else if (hasHeaders(sizeMode) && writeCrc) {
+        stream->seekp((std::streamoff)(headerEnd - getSizeWidth(dataSize) - DWORD));
+        conv<uint32_t> crc_conv{crc};
+        stream->write((char*)&crc_conv.data, DWORD);
+    }
+    return finishAppend(name, crc, offset, dataOffset, dataSize);
+}
+
+FileInfo StaticArchive::append(const std::string &name, std::span<const iovec> segments) {
+    if (!isWriteable())
+        throw ReadOnlyException();
+
+    // the crc goes into the header, so it is computed up front
+    uint64_t dataSize = 0;
+    uint32_t crc = crc32(0, nullptr, 0);
+    for (const iovec &segment : segments) {
+        // a null buffer would restart the crc
+        if (segment.iov_len > 0)
+            crc = crc32_z(crc, (const Bytef*)segment.iov_base, segment.iov_len);
+        dataSize += segment.iov_len;
+    }
+
+    // header and padding in front of the payload, padding of a record behind it
+    std::vector<uint8_t> prefix;
+    uint64_t start = entriesEnd;
+    uint64_t offset = entriesEnd;
+    if (sizeMode == SizeModeFixed) {
+        if (name.size() > 0xff)
+            throw InvalidNameSizeException(name.size());
+        if (dataSize != recordSize)
+            throw InvalidDataSizeException(dataSize);
+        start = offset = getRecordBase() + fileCount * getRecordStride();
+    } else if (sizeMode == SizeModeColumns) {
+        if (name.size() > 0xff)
+            throw InvalidNameSizeException(name.size());
+        offset = align(entriesEnd);
+    } else {
+        putHeader(prefix, name, writeCrc ? crc : 0, dataSize);
+    }
+    uint64_t dataOffset = align(start + prefix.size());
+    prefix.resize(dataOffset - start);
+    std::vector<uint8_t> suffix(sizeMode == SizeModeFixed ? getRecordStride() - recordSize : 0);
+
+    std::vector<iovec> gathered;
+    gathered.reserve(segments.size() + 2);
+    gathered.push_back(iovec{prefix.data(), prefix.size()});
+    gathered.insert(gathered.end(), segments.begin(), segments.end());
+    gathered.push_back(iovec{suffix.data(), suffix.size()});
+
+    if (archiveFile.isOpen()) {
+        // whatever the stream still buffers belongs in front
+        stream->flush();
+        archiveFile.write(start, gathered);
+    } else {
+        stream->clear();
+        stream->seekp((std::streamoff)start);
+        for (const iovec &segment : gathered)
+            stream->write((const char*)segment.iov_base, (std::streamsize)segment.iov_len);
+    }
+    return finishAppend(name, crc, offset, dataOffset, dataSize);
+}
+
+FileInfo StaticArchive::finishAppend(const std::string &name, uint32_t crc, uint64_t offset, uint64_t dataOffset,
+                                     uint64_t dataSize) {
+    if (!hasHeaders(sizeMode)) {
+        // a table loaded without names (or none at all) is filled up first
+        recordNames.resize(fileCount);
+        recordCrcs.resize(fileCount);
+        recordNames.push_back(name);
+        recordCrcs.push_back(crc);
+        if (sizeMode == SizeModeColumns) {
+            columnSizes.push_back(dataSize);
+            columnOffsets.push_back(dataOffset);
+        }
+    }
+    fileCount++;
+    entriesEnd = sizeMode == SizeModeFixed ? offset + getRecordStride() : dataOffset + dataSize;
+    commitPending(entriesEnd - offset);
+
+    return FileInfo{name, dataSize, crc, offset, dataOffset};
+}
+
+void StaticArchive::readRange(uint64_t offset, char *out, uint64_t size) {
+    if (readUpTo(offset, out, size) != size)
+        throw std::ios_base::failure("Unexpected end of archive");
+}
+
+uint64_t StaticArchive::readUpTo(uint64_t offset, char *out, uint64_t size) {
+    if (archiveFile.isOpen()) {
+        if (isWriteable())
+            stream->flush();
+        return archiveFile.read(offset, out, size);
+    }
+
+    stream->clear();
+    stream->seekg((std::streamoff)offset);
+    stream->read(out, (std::streamsize)size);
+    return stream->gcount();
+}
+
+void StaticArchive::readInto(const FileInfo &file, char *out) {
+    readRange(file.dataOffset, out, file.size);
+    verify(file, out);
+}
+
+void StaticArchive::verify(const FileInfo &file, const char *data) const {
+    if (checks && writeCrc)
+        checkCrc(file.name, file.crc, data, file.size);
 }
 
 
@@ -170,6 +1387,8 @@ bool StaticArchive::getClosed() const noexcept { return closed; }
 
 Mode StaticArchive::getMode() const noexcept { return mode; }
 
+bool StaticArchive::getPositionalReads() const noexcept { return archiveFile.isOpen() && !isWriteable(); }
+
 uint64_t StaticArchive::getMaxFilesize() const noexcept {
     switch (sizeMode) {
         case SizeMode16:
@@ -180,6 +1399,21 @@ uint64_t StaticArchive::getMaxFilesize() const noexcept {
         case SizeMode64:
             //       |--||--||--||--|
             return 0xffffffffffffffff;
+        case SizeModeFixed:
+            return recordSize;
+        case SizeModeVarint:
+        case SizeModeColumns:
+            return 0xffffffffffffffff;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+uint64_t StaticArchive::getRecordSize() const noexcept { return recordSize; }
+
+uint32_t StaticArchive::getAlignment() const noexcept { return alignment; }
+
+bool StaticArchive::getIndexed() const noexcept { return indexed; }
+
+bool StaticArchive::getFrontCoded() const noexcept { return frontCoded; }
+
+uint64_t StaticArchive::getBaseOffset() const noexcept { return baseOffset; }
@@ -2,60 +2,214 @@
 #ifndef CPP_STATIC_HPP
 #define CPP_STATIC_HPP
 
+#include <cstddef>
 #include <iostream>
 #include <tuple>
 #include <memory>
 #include <vector>
+#include <span>
+#include <string_view>
+#include <chrono>
+#include <ranges>
+#include <type_traits>
+#include <stdexcept>
+
+#include "io.h++"
 
 #define STATIC_FLAG_VERBOSE        0b10000000
 #define STATIC_FLAG_ONLY_NAMES     0b01000000
 #define STATIC_FLAG_IGNORE_ERRORS  0b00100000
 #define STATIC_FLAG_WRITE_CRC32    0b00010000
 #define STATIC_FLAG_DISABLE_CHECKS 0b00001000
+#define STATIC_FLAG_PREALLOCATE    0b00000100
+#define STATIC_FLAG_AUTO_SIZE_MODE 0b00000010
 
 
 #define STATIC_MAGIC { 0x91, 0xde, 0xee, 0x9c, 0x80, 0x5c, 0x23, 0xe6 };
 
+// magic + general purpose + file count + size mode + flags
+#define STATIC_SIGNATURE_SIZE 22
+
+// bits of the signature flags byte (formerly the crc byte)
+#define STATIC_SIG_CRC      0b00000001
+#define STATIC_SIG_EXTENDED 0b00000010
+#define STATIC_SIG_FRONT_CODED 0b00000100
+
+// with front coded names every STATIC_NAME_RESTART-th entry stores its full name
+#define STATIC_NAME_RESTART 16
+
+// fields of the signature extension known to this version, see static.bt
+#define STATIC_EXTENSION_SIZE 36
+
+// six counts and four bit widths (padded) in front of the name index, see ParsedIndex
+#define STATIC_INDEX_HEADER_SIZE 56
+// entries per block of the name index, blocks of front coded archives start at full names
+#define STATIC_INDEX_BLOCK STATIC_NAME_RESTART
+// share of used slots in the perfect hash of the index
+#define STATIC_INDEX_LOAD 0.9
+// slots per stored rank of the index, the rest is counted from the slot bits
+#define STATIC_INDEX_RANK_SLOTS 512
+// blocks per full (u64) block offset of the index, the others are stored relative to it
+#define STATIC_INDEX_ANCHOR 64
+
+// entries per batch when all entries are scanned (for their end, or to build the
+// index), a multiple of STATIC_NAME_RESTART
+#define STATIC_SCAN_BATCH 65536
+
+// trailer behind an archive attached to another file, see locate.h++:
+// archive offset + archive size + trailer magic
+#define STATIC_TRAILER_MAGIC { 0xe6, 0x23, 0x5c, 0x80, 0x9c, 0xee, 0xde, 0x91 };
+#define STATIC_TRAILER_SIZE 24
+
+// chunk size used when moving payloads between streams
+#define STATIC_BUFFER_SIZE 200000
+
+// listing reads the headers in windows of this many bytes, payloads that end
+// inside a window are skipped without another read
+#define STATIC_SCAN_WINDOW 16384
+
+// read scheduling: payloads closer than STATIC_MERGE_GAP bytes are fetched
+// with a single read, as long as the merged read stays below STATIC_MAX_RUN
+#define STATIC_MERGE_GAP 65536
+#define STATIC_MAX_RUN   8388608
+
+// bytes of upcoming payloads announced to the kernel ahead of the consumer
+#define STATIC_HINT_WINDOW 33554432
+
 namespace Static {
 
     enum SizeMode {
         SizeMode16,
         SizeMode32,
         SizeMode64,
+        // every entry has the same size (record size) and no header, entry i is
+        // stored at i * recordSize behind the signature. Names and crcs are kept
+        // in a table behind the records, which is left out if neither is used.
+        SizeModeFixed,
+        // sizes are stored as LEB128 varints (1 byte below 128, 2 below 16384, ...),
+        // so archives of mostly small entries keep small headers
+        SizeModeVarint,
+        // no headers either: the payloads are packed behind the signature and the
+        // sizes, crcs and names follow them as separate columns (see static.bt), so
+        // listing an archive of tiny entries reads the columns instead of every page
+        SizeModeColumns,
     };
 
+    // the smallest of SizeMode16, SizeMode32 and SizeMode64 whose size field holds size
+    constexpr SizeMode fittingSizeMode(uint64_t size) noexcept {
+        return size <= 0xffff ? SizeMode16 : size <= 0xffffffff ? SizeMode32 : SizeMode64;
+    }
+
+    // false for the layouts which keep names and sizes apart from the payloads
+    constexpr bool hasHeaders(SizeMode sizeMode) noexcept {
+        return sizeMode != SizeModeFixed && sizeMode != SizeModeColumns;
+    }
+
     enum Mode {
         ModeRead,
         ModeAppend,
         ModeCreate,
     };
 
+    // When a writer makes its appends durable, see commit
+    enum Durability {
+        // whenever the system writes the data back
+        DurabilityNone,
+        // a commit once Options::syncBytes or Options::syncInterval are reached
+        // (checked on append) and on close, appends in between share one sync
+        DurabilityPeriodic,
+        DurabilityClose,
+    };
+
     struct FileInfo {
-        const char *name;
+        std::string name;
         uint64_t size;
         uint32_t crc;
         uint64_t offset;
         uint64_t dataOffset;
     };
 
-    struct EntryHeader {
-        std::string name;
-        uint32_t crc;
-        uint64_t dataSize;
+    // Everything that is fixed when an archive is created. Archives opened for
+    // reading or appending take these from their signature instead, except for
+    // the durability, which belongs to the writer.
+    struct Options {
+        SizeMode sizeMode = SizeMode64;
+        uint8_t flags = STATIC_FLAG_WRITE_CRC32;
+        uint64_t recordSize = 0; // SizeModeFixed only, must not be 0 there
+        // Payloads start at multiples of the alignment (a power of two), the gap
+        // behind each header is zero padded. Records are padded to a multiple.
+        uint32_t alignment = 1;
+        // Builds a name index (a perfect hash, 3 to 5 bytes per name, see INFO.md) when
+        // the archive is closed, getFileInfo and getShards then need no scan. Appends keep it.
+        bool index = false;
+        // Headers store the length of the prefix shared with the previous name plus
+        // the rest, which pays off for deep directory trees. Needs headers (hasHeaders).
+        bool frontCodedNames = false;
+        // Anything but DurabilityNone needs headers (see commit).
+        Durability durability = DurabilityNone;
+        // DurabilityPeriodic only, 0 disables the limit. Without any limit every
+        // append is committed.
+        uint64_t syncBytes = 0;
+        std::chrono::milliseconds syncInterval{0};
+        // Writes the plain signature without the extension, for readers which do
+        // not know it (the Python port). Only for SizeMode16/32/64 without any of
+        // the options above. Such archives record no end, so appends and recovery
+        // scan all entries first.
+        bool legacySignature = false;
+    };
+
+    // A contiguous range of entries, see getShards. All fields are plain numbers,
+    // so a shard can be computed once and handed to other processes.
+    struct Shard {
+        uint64_t firstEntry; // index of the first entry inside the archive
+        uint64_t count;
+        uint64_t offset;     // header offset of the first entry
+        uint64_t end;        // end of the last payload
+        uint64_t bytes;      // payload bytes
+    };
+
+    // What add() appended, and the header bytes it projected for all inputs
+    // (in the size mode it picked) before anything was written.
+    struct AddResult {
+        std::vector<FileInfo> files;
+        SizeMode sizeMode;
+        uint64_t headerBytes;
+        uint64_t dataBytes;
     };
 
+    // bit fields are allocated starting at the least significant bit,
+    // so they are listed in reverse order of the STATIC_FLAG_* values
     union Flags{
+        uint8_t v;
         struct FlagsStruct{
-            uint8_t verbose : 1;
-            uint8_t onlyNames : 1;
-            uint8_t ignoreErrors : 1;
+            uint8_t : 1;
+            uint8_t autoSizeMode : 1;
+            uint8_t preallocate : 1;
+            uint8_t disableChecks : 1;
             uint8_t writeCrc : 1;
-            uint8_t checks : 1;
+            uint8_t ignoreErrors : 1;
+            uint8_t onlyNames : 1;
+            uint8_t verbose : 1;
         } f;
-        uint8_t v;
     };
 
     bool is_archive(const char *path);
+    // Throws a ChecksumMismatchException if the crc of size bytes at data is not
+    // expected. The archive classes verify through it when checks apply.
+    void checkCrc(std::string_view name, uint32_t expected, const void *data, uint64_t size);
+
+    // Types whose pointers name one object. Pointers to characters or bytes are
+    // strings and buffers, arrays are ranges, both take the range overloads.
+    template<typename T>
+    concept SingleObject = std::is_trivially_copyable_v<T> && !std::is_array_v<T> &&
+                           !std::is_same_v<std::remove_cv_t<T>, char> &&
+                           !std::is_same_v<std::remove_cv_t<T>, signed char> &&
+                           !std::is_same_v<std::remove_cv_t<T>, unsigned char> &&
+                           !std::is_same_v<std::remove_cv_t<T>, char8_t> &&
+                           !std::is_same_v<std::remove_cv_t<T>, std::byte>;
+
+    class Sampler;
+    class AccessPlan;
 
     class StaticArchive {
     public:
@@ -64,58 +218,215 @@ namespace Static {
         StaticArchive(const std::string& path, Mode mode, SizeMode sizeMode);
         StaticArchive(const std::string& path, Mode mode, SizeMode sizeMode, uint8_t flags);
         StaticArchive(std::fstream *stream, Mode mode, SizeMode sizeMode, uint8_t flags);
+        // SizeModeFixed archives are created with Options::recordSize
+        StaticArchive(const std::string& path, Mode mode, const Options& options);
+        // Read-only archive starting at baseOffset inside a larger file. The path only
+        // constructors find archives attached with attachArchive on their own.
+        StaticArchive(const std::string& path, uint64_t baseOffset);
+        ~StaticArchive();
 
-        template<typename T>
+        // The bytes of a single object, see SingleObject.
+        template<SingleObject T>
         FileInfo append(const std::string &name, T *data);
+        // The bytes of all elements of a contiguous range (std::vector, std::array,
+        // std::span, std::string, ...) with a single write. String literals are
+        // arrays and keep their terminating zero, a std::string_view drops it.
+        template<std::ranges::contiguous_range R>
+            requires std::is_trivially_copyable_v<std::ranges::range_value_t<R>> &&
+                     (!std::is_same_v<std::ranges::range_value_t<R>, iovec>)
+        FileInfo append(const std::string &name, const R &data);
         FileInfo append(const std::string &name, std::basic_ios<uint8_t>& stream);
+        // Appends the concatenation of the segments, e.g. a header, a body and a footer
+        // buffer, without copying them together. The header, the padding and all segments
+        // go out with one positional gather write (one stream write per segment without
+        // a file path).
+        FileInfo append(const std::string &name, std::span<const iovec> segments);
 
-        template<typename T>
+        // Reads a payload of exactly sizeof(T) bytes into out, throws std::invalid_argument
+        // for any other size. Buffers take the span overload.
+        template<SingleObject T>
         uint64_t read(FileInfo file, T* out);
-
-        template<typename T>
+        // Throws std::invalid_argument if the payload is not a whole number of elements,
+        // or if out is too small.
+        template<typename T> requires std::is_trivially_copyable_v<T>
+        uint64_t read(FileInfo file, std::span<T> out);
+        template<typename T> requires std::is_trivially_copyable_v<T>
         uint64_t read(FileInfo file, std::vector<T>& out);
         uint64_t read(FileInfo file, std::string& out);
         uint64_t read(FileInfo file, std::basic_ios<uint8_t>& stream);
 
-        std::vector<FileInfo> add(std::string path, uint8_t flags = 0);
+        // Reads several entries at once. The reads are issued in archive order and
+        // neighbouring payloads are merged, out[i] receives the data of files[i].
+        uint64_t read(const std::vector<FileInfo>& files, std::vector<std::string>& out);
+
+        // Reads files[i] into buffers[i], which must hold at least files[i].size bytes.
+        // The payloads are read with one scatter read per merged run, straight into the
+        // buffers. Checksums are verified on up to `threads` threads, 0 skips them.
+        uint64_t readBatch(std::span<const FileInfo> files, std::span<const std::span<char>> buffers,
+                           unsigned threads = 1);
+
+        // All inputs are checked against the maximal filesize before anything is
+        // written. With STATIC_FLAG_PREALLOCATE the space for all inputs is reserved
+        // in the archive first. With STATIC_FLAG_AUTO_SIZE_MODE an empty archive of
+        // SizeMode16, 32 or 64 switches to the smallest of them which fits the largest
+        // input. The result tells the mode and the projected header bytes.
+        AddResult add(std::string path, uint8_t flags = 0);
+
+        // Iterates all entries in a shuffled order, which only depends on seed and
+        // epoch. Up to `prefetch` payloads are read ahead on a background thread.
+        // With a blockSize > 1 only windows of that many neighbouring entries are
+        // shuffled (and the window order), which keeps the reads mostly sequential.
+        std::unique_ptr<Sampler> sampler(uint64_t seed, uint64_t epoch, size_t prefetch = 8, size_t blockSize = 0);
+        // checkCrc for the payload of file, unless checks are disabled or the archive has no crcs
+        void verify(const FileInfo &file, const char *data) const;
+
+        // Readahead hints for entries that will be read in the given order, see AccessPlan.
+        // The plan must not outlive the archive. Without a file descriptor it does nothing.
+        AccessPlan getAccessPlan(std::vector<FileInfo> order, uint64_t window = STATIC_HINT_WINDOW);
+        // Writes the entries below path, throws an UnsafeNameException for names
+        // which are absolute or climb out of it with "..".
         void extract(std::string path, uint8_t flags = 0);
         void extract(std::string path, std::vector<FileInfo>& names, uint8_t flags = 0);
 
+        // Uses the name index if the archive has one (and a file descriptor), which
+        // costs one probe plus the headers of one block, otherwise all headers are scanned.
         FileInfo getFileInfo(std::string name);
         void getFileInfos(std::vector<FileInfo>& out);
+        // Only reads the headers inside the shard.
+        void getFileInfos(const Shard& shard, std::vector<FileInfo>& out);
+        // Splits the archive into `count` contiguous shards of about the same size.
+        // With a name index the shards are cut at its blocks without reading a header.
+        std::vector<Shard> getShards(size_t count);
+        // O(1) for archives without headers (SizeModeFixed and SizeModeColumns),
+        // fixed size records without a name are named by their index.
+        FileInfo getRecordInfo(uint64_t index) const;
         void getFileNames(std::vector<std::string>& out);
 
-        bool isReadable();
-        bool isWriteable();
+        bool isReadable() const;
+        bool isWriteable() const;
 
         void flush();
+        // Ends a transaction: the entries appended since the last commit reach the
+        // disk before the signature which counts them, the signature is the commit
+        // record. An append after a crash continues behind the last commit (and the
+        // complete entries of the interrupted transaction in archives with crcs).
+        // Needs a file path and headers: the record table and the columns live behind
+        // the payloads, where the next append overwrites them, so SizeModeFixed and
+        // SizeModeColumns archives throw a std::logic_error.
+        void commit();
+        // The destructor closes as well, but swallows the errors.
         void close();
 
         [[nodiscard]] SizeMode getSizeMode() const noexcept;
         [[nodiscard]] uint64_t getFileCount() const noexcept;
         [[nodiscard]] uint64_t getMaxFilesize() const noexcept;
+        [[nodiscard]] uint64_t getRecordSize() const noexcept;
+        [[nodiscard]] uint32_t getAlignment() const noexcept;
+        [[nodiscard]] bool getIndexed() const noexcept;
+        [[nodiscard]] bool getFrontCoded() const noexcept;
+        // where the archive starts inside its file, FileInfo offsets are file offsets
+        [[nodiscard]] uint64_t getBaseOffset() const noexcept;
         [[nodiscard]] bool getWriteCrc() const noexcept;
         [[nodiscard]] bool getClosed() const noexcept;
         [[nodiscard]] Mode getMode() const noexcept;
+        // true if payload reads do not share the stream position and may run concurrently
+        [[nodiscard]] bool getPositionalReads() const noexcept;
 
-        uint32_t generalPurposeField;
-        bool checks;
+        uint32_t generalPurposeField = 0;
+        bool checks = true;
     private:
         inline void setup(const std::string& path, const Mode& mode_, const SizeMode& sizeMode_);
+        void init();
         bool checkSignature();
         void loadSignature();
         void writeSignature();
-        EntryHeader readHeader();
-        void writeheader(std::string &name, uint32_t crc, uint64_t dataSize);
+        [[nodiscard]] uint64_t align(uint64_t offset) const noexcept;
+        // offset fields are stored relative to the archive start, 0 means none
+        [[nodiscard]] uint64_t fromStored(uint64_t offset) const noexcept;
+        [[nodiscard]] uint64_t toStored(uint64_t offset) const noexcept;
+        [[nodiscard]] uint64_t getRecordBase() const noexcept;
+        [[nodiscard]] uint64_t getRecordStride() const noexcept;
+        void loadRecordTable();
+        void writeRecordTable();
+        void loadColumns();
+        void writeColumns();
+        // the record table or the columns, whatever the size mode keeps behind the payloads
+        void writeTable();
+        // Calls f(std::vector<FileInfo>&) with all entries, STATIC_SCAN_BATCH at a
+        // time, and returns where the last one ends.
+        template<typename F>
+        uint64_t scanBatches(F &&f);
+        void writeIndex();
+        // maps the name index on first use
+        std::span<const uint8_t> getIndex();
+        void dropIndex();
+        // where the next entry goes, recovers an interrupted transaction
+        void findEntriesEnd();
+        // keeps the complete entries behind entriesEnd, up to the first one that does not check out
+        template<typename Codec>
+        void recoverEntries(uint64_t fileSize);
+        [[nodiscard]] bool checkRange(uint64_t offset, uint64_t size, uint32_t crc);
+        // commits if the durability policy asks for it, bytes were just appended
+        void commitPending(uint64_t bytes);
+        FileInfo getFileInfoAt(uint64_t offset);
+        void writeheader(const std::string &name, uint32_t crc, uint64_t dataSize);
+        void putHeader(std::vector<uint8_t> &out, const std::string &name, uint32_t crc, uint64_t dataSize);
+        void writePadding(uint64_t size);
+        // bytes of the size field of an entry of dataSize bytes
+        [[nodiscard]] uint8_t getSizeWidth(uint64_t dataSize) const noexcept;
+        [[nodiscard]] uint64_t getHeaderSize(const std::string &name, uint64_t dataSize) const noexcept;
+
+        template<typename CharT>
+        FileInfo appendStreambuf(const std::string &name, std::basic_streambuf<CharT> *buf);
+        // Codec is the HeaderCodec of the archive (see parse.h++), picked once per scan
+        template<typename Codec>
+        void scanHeaders(const Shard &shard, std::vector<FileInfo> &out);
+        // bookkeeping once the payload is written, offset as in FileInfo
+        FileInfo finishAppend(const std::string &name, uint32_t crc, uint64_t offset, uint64_t dataOffset,
+                              uint64_t dataSize);
+        void readRange(uint64_t offset, char *out, uint64_t size);
+        // like readRange, but returns the bytes read instead of failing at the end
+        uint64_t readUpTo(uint64_t offset, char *out, uint64_t size);
+        // reads and verifies the payload of file
+        void readInto(const FileInfo &file, char *out);
 
-        std::fstream *stream;
+        // the stream opened from a path, streams handed in belong to the caller
+        std::unique_ptr<std::fstream> ownedStream;
+        std::fstream *stream = nullptr;
+        std::string path;
+        File archiveFile;
         SizeMode sizeMode = SizeMode64;
         Mode mode = ModeRead;
         uint64_t fileCount = 0;
         bool writeCrc = true;
         bool closed = false;
 
-        ~StaticArchive();
+        uint64_t baseOffset = 0;
+
+        // signature extension, offsets are file offsets (stored relative to baseOffset)
+        uint64_t dataStart = STATIC_SIGNATURE_SIZE;
+        uint32_t extensionSize = 0;
+        uint64_t recordSize = 0;
+        uint64_t tableOffset = 0;
+        uint32_t alignment = 1;
+        std::vector<std::string> recordNames;
+        std::vector<uint32_t> recordCrcs;
+        // SizeModeColumns, names and crcs are kept in recordNames and recordCrcs
+        std::vector<uint64_t> columnSizes;
+        std::vector<uint64_t> columnOffsets;
+        uint64_t indexOffset = 0;
+        uint64_t entriesEnd = 0; // end of the last payload (or record)
+        bool indexed = false;
+        bool frontCoded = false;
+        bool legacySignature = false; // of a new archive, see Options
+        std::string lastName; // of the last entry written, for front coding
+
+        Durability durability = DurabilityNone;
+        uint64_t syncBytes = 0;
+        std::chrono::milliseconds syncInterval{0};
+        uint64_t pendingBytes = 0; // appended since the last commit
+        std::chrono::steady_clock::time_point lastCommit = std::chrono::steady_clock::now();
+        Mapping indexMap;
     };
 
     // Exceptions
@@ -131,6 +442,118 @@ namespace Static {
 
         uint64_t size;
     };
+
+    class InvalidDataSizeException : public std::exception {
+    public:
+        explicit InvalidDataSizeException(uint64_t size) {
+            this->size = size;
+        }
+
+        virtual const char* what() const throw() {
+            return "Data size exceeds the maximal filesize of the size mode";
+        }
+
+        uint64_t size;
+    };
+
+    class InvalidSignatureException : public std::exception {
+    public:
+        virtual const char* what() const throw() {
+            return "Invalid file signature";
+        }
+    };
+
+    class ReadOnlyException : public std::exception {
+    public:
+        virtual const char* what() const throw() {
+            return "Cannot write to a read-only archive";
+        }
+    };
+
+    class EntryNotFoundException : public std::exception {
+    public:
+        explicit EntryNotFoundException(std::string name) {
+            this->name = std::move(name);
+        }
+
+        virtual const char* what() const throw() {
+            return "Entry is not contained inside the archive";
+        }
+
+        std::string name;
+    };
+
+    class UnsafeNameException : public std::exception {
+    public:
+        explicit UnsafeNameException(std::string name) {
+            this->name = std::move(name);
+        }
+
+        virtual const char* what() const throw() {
+            return "Entry name leaves the target directory";
+        }
+
+        std::string name;
+    };
+
+    class ChecksumMismatchException : public std::exception {
+    public:
+        ChecksumMismatchException(std::string name, uint32_t expected, uint32_t actual) {
+            this->name = std::move(name);
+            this->expected = expected;
+            this->actual = actual;
+        }
+
+        virtual const char* what() const throw() {
+            return "Checksum mismatch";
+        }
+
+        std::string name;
+        uint32_t expected;
+        uint32_t actual;
+    };
+
+    // Typed appends and reads, trivially copyable data is moved as raw bytes
+    template<SingleObject T>
+    FileInfo StaticArchive::append(const std::string &name, T *data) {
+        iovec segment{(void*)data, sizeof(T)};
+        return append(name, std::span<const iovec>(&segment, 1));
+    }
+
+    template<std::ranges::contiguous_range R>
+        requires std::is_trivially_copyable_v<std::ranges::range_value_t<R>> &&
+                 (!std::is_same_v<std::ranges::range_value_t<R>, iovec>)
+    FileInfo StaticArchive::append(const std::string &name, const R &data) {
+        iovec segment{(void*)std::ranges::data(data), std::ranges::size(data) * sizeof(std::ranges::range_value_t<R>)};
+        return append(name, std::span<const iovec>(&segment, 1));
+    }
+
+    template<SingleObject T>
+    uint64_t StaticArchive::read(FileInfo file, T *out) {
+        if (file.size != sizeof(T))
+            throw std::invalid_argument("Entry does not hold a single object of that type");
+        readInto(file, (char*)out);
+        return file.size;
+    }
+
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    uint64_t StaticArchive::read(FileInfo file, std::span<T> out) {
+        if (file.size % sizeof(T) != 0)
+            throw std::invalid_argument("Entry is not a whole number of elements");
+        if (out.size_bytes() < file.size)
+            throw std::invalid_argument("Buffer too small for " + file.name);
+        readInto(file, (char*)out.data());
+        return file.size;
+    }
+
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    uint64_t StaticArchive::read(FileInfo file, std::vector<T> &out) {
+        if (file.size % sizeof(T) != 0)
+            throw std::invalid_argument("Entry is not a whole number of elements");
+        out.resize(file.size / sizeof(T));
+        readInto(file, (char*)out.data());
+        return file.size;
+    }
 }
 
 #endif //CPP_STATIC_HPP
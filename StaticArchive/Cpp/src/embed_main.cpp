@@ -0,0 +1,105 @@
+#include "core/static.h++"
+#include "core/phash.h++"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace Static;
+namespace fs = std::filesystem;
+
+
+// usage: static_embed <directory> <symbol> <output.cpp> <output.h++> [constexpr]
+//
+// Packs the directory into <symbol>.arch next to the outputs and writes a
+// translation unit holding its bytes plus a header with the perfect hash
+// table for Static::EmbeddedArchive. Used by static_embed_directory().
+// With constexpr the bytes go into the header instead, where the archive is
+// validated at compile time and payloads are usable in constant expressions.
+
+
+static std::string quote(std::string_view text) {
+    std::ostringstream out;
+    out << '"';
+    for (char c : text) {
+        if (std::isalnum((unsigned char)c) || std::string_view("./_- ").find(c) != std::string_view::npos)
+            out << c;
+        else // octal escapes have at most three digits, unlike hex escapes
+            out << '\\' << std::oct << std::setw(3) << std::setfill('0') << (int)(uint8_t)c << std::dec;
+    }
+    out << '"';
+    return out.str();
+}
+
+int main(int argc, char **argv) {
+    if (argc != 5 && !(argc == 6 && std::string_view(argv[5]) == "constexpr")) {
+        std::cerr << "usage: " << argv[0] << " <directory> <symbol> <output.cpp> <output.h++> [constexpr]\n";
+        return 1;
+    }
+    bool inHeader = argc == 6;
+
+    std::string directory = argv[1], symbol = argv[2];
+    fs::path source = argv[3], header = argv[4];
+    fs::path archivePath = source.parent_path() / (symbol + ".arch");
+
+    std::vector<FileInfo> infos;
+    {
+        StaticArchive archive(archivePath.string(), ModeCreate, SizeMode64, STATIC_FLAG_WRITE_CRC32);
+        archive.add(directory);
+        archive.flush();
+        archive.getFileInfos(infos);
+    }
+
+    std::vector<std::string_view> names;
+    for (const FileInfo &info : infos)
+        names.push_back(info.name);
+    PerfectHash hash = buildPerfectHash(names);
+
+    std::vector<const FileInfo *> slots(infos.size());
+    for (const FileInfo &info : infos)
+        slots[perfectHashSlot(info.name, hash)] = &info;
+
+    std::ifstream archive(archivePath, std::ifstream::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(archive)), std::istreambuf_iterator<char>());
+
+    std::string declaration = "const unsigned char " + symbol + "_data[" + std::to_string(std::max<size_t>(bytes.size(), 1)) + "]";
+    std::ostringstream array;
+    array << "alignas(64) " << (inHeader ? "inline constexpr " : "extern ") << declaration << " = {";
+    for (size_t i = 0; i < bytes.size(); i++)
+        array << (i % 16 ? " " : "\n    ") << "0x" << std::hex << std::setw(2) << std::setfill('0')
+              << (int)(uint8_t)bytes[i] << std::dec << ",";
+    array << "\n};\n";
+
+    std::ofstream cpp(source);
+    cpp << "// generated by static_embed from " << directory << ", do not edit\n";
+    if (!inHeader)
+        cpp << "\n" << array.str();
+
+    std::string guard = "STATIC_EMBEDDED_" + symbol + "_H";
+    std::ofstream hpp(header);
+    hpp << "// generated by static_embed from " << directory << ", do not edit\n\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <array>\n#include \"core/embedded.h++\"\n";
+    if (inHeader) {
+        hpp << "#include \"core/parse.h++\"\n\n" << array.str() << "\n"
+            << "static_assert(Static::validateArchive(" << symbol << "_data) == " << infos.size() << ");\n\n";
+    } else {
+        hpp << "\nextern " << declaration << ";\n\n";
+    }
+
+    hpp << "inline constexpr std::array<Static::EmbeddedEntry, " << slots.size() << "> " << symbol << "_entries{{";
+    for (const FileInfo *info : slots)
+        hpp << "\n    {" << quote(info->name) << ", " << info->dataOffset << ", " << info->size << ", " << info->crc << "},";
+    hpp << "\n}};\n\n"
+        << "inline constexpr std::array<uint32_t, " << hash.displacements.size() << "> " << symbol << "_displacements{{";
+    for (size_t i = 0; i < hash.displacements.size(); i++)
+        hpp << (i % 16 ? " " : "\n    ") << hash.displacements[i] << ",";
+    hpp << "\n}};\n\n"
+        << "inline constexpr Static::EmbeddedArchive " << symbol << "{\n    "
+        << symbol << "_data, " << bytes.size() << ", " << symbol << "_entries, " << symbol << "_displacements, "
+        << hash.seed << "\n};\n\n"
+        << "#endif //" << guard << "\n";
+    return 0;
+}
@@ -5,4 +5,1289 @@
 #ifndef STATICARCHIVE_TESTSUITE1_H
 #define STATICARCHIVE_TESTSUITE1_H
 
+#include <cxxtest/TestSuite.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "../core/static.h++"
+#include "../core/schedule.h++"
+#include "../core/sampler.h++"
+#include "../core/loader.h++"
+#include "../core/advise.h++"
+#include "../core/embedded.h++"
+#include "../core/memory.h++"
+#include "../core/parse.h++"
+#include "../core/locate.h++"
+#include "../core/shared.h++"
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <fcntl.h>
+
+using namespace Static;
+namespace fs = std::filesystem;
+
+
+class TestSuite1 : public CxxTest::TestSuite {
+public:
+    fs::path temp;
+
+    void setUp() override {
+        temp = fs::temp_directory_path() / "static_test_suite";
+        fs::remove_all(temp);
+        fs::create_directories(temp);
+    }
+
+    void tearDown() override {
+        fs::remove_all(temp);
+    }
+
+    // writes `count` entries named 0..count-1, entry i holds i + 1 bytes of ('a' + i % 26)
+    std::string makeArchive(int count, SizeMode sizeMode = SizeMode32) {
+        std::string path = (temp / "test.arch").string();
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+
+        StaticArchive sa(path, ModeCreate, sizeMode, STATIC_FLAG_WRITE_CRC32);
+        for (int i = 0; i < count; i++) {
+            std::ofstream(src / std::to_string(i), std::ofstream::binary) << std::string(i + 1, char('a' + i % 26));
+            sa.add((src / std::to_string(i)).string(), STATIC_FLAG_ONLY_NAMES);
+        }
+        sa.close();
+        return path;
+    }
+
+    void testRoundTrip() {
+        std::string path = makeArchive(30, SizeMode16);
+        StaticArchive sa(path);
+
+        TS_ASSERT_EQUALS(sa.getFileCount(), 30u);
+        TS_ASSERT_EQUALS(sa.getSizeMode(), SizeMode16);
+        TS_ASSERT(sa.getWriteCrc());
+        TS_ASSERT(is_archive(path.c_str()));
+
+        std::string data;
+        sa.read(sa.getFileInfo("7"), data);
+        TS_ASSERT_EQUALS(data, std::string(8, 'h'));
+        TS_ASSERT_THROWS(sa.getFileInfo("missing"), EntryNotFoundException);
+    }
+
+    void testPlanReads() {
+        std::vector<FileInfo> files{
+                {"c", 10, 0, 0, 200},
+                {"a", 10, 0, 0, 0},
+                {"far", 10, 0, 0, 1000000},
+                {"b", 10, 0, 0, 100},
+        };
+
+        std::vector<ReadRun> runs = planReads(files, 100, 4096);
+        TS_ASSERT_EQUALS(runs.size(), 2u);
+        TS_ASSERT_EQUALS(runs[0].offset, 0u);
+        TS_ASSERT_EQUALS(runs[0].size, 210u);
+        TS_ASSERT_EQUALS(runs[0].members, (std::vector<size_t>{1, 3, 0}));
+        TS_ASSERT_EQUALS(runs[1].members, (std::vector<size_t>{2}));
+    }
+
+    void testBatchReadKeepsOrder() {
+        StaticArchive sa(makeArchive(40));
+
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+        std::vector<FileInfo> wanted{infos[33], infos[2], infos[17], infos[2]};
+
+        std::vector<std::string> out;
+        sa.read(wanted, out);
+        TS_ASSERT_EQUALS(out.size(), 4u);
+        TS_ASSERT_EQUALS(out[0], std::string(34, 'h'));
+        TS_ASSERT_EQUALS(out[1], std::string(3, 'c'));
+        TS_ASSERT_EQUALS(out[2], std::string(18, 'r'));
+        TS_ASSERT_EQUALS(out[3], out[1]);
+    }
+
+    void testSelectiveExtract() {
+        StaticArchive sa(makeArchive(20));
+
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+        std::vector<FileInfo> wanted{infos[12], infos[3]};
+
+        fs::path dest = temp / "out";
+        fs::create_directories(dest);
+        sa.extract(dest.string(), wanted);
+
+        TS_ASSERT(fs::exists(dest / "12"));
+        TS_ASSERT(fs::exists(dest / "3"));
+        TS_ASSERT(!fs::exists(dest / "4"));
+        TS_ASSERT_EQUALS(fs::file_size(dest / "12"), 13u);
+    }
+
+    void testUnsafeNames() {
+        std::string path = (temp / "unsafe.arch").string();
+        {
+            StaticArchive sa(path, ModeCreate);
+            sa.append("sub/../inside", std::string("i"));
+            sa.append("../escaped.txt", std::string("e"));
+            sa.append((temp / "absolute.txt").string(), std::string("a"));
+            sa.append("sub/../..", std::string("d"));
+        }
+
+        fs::path dest = temp / "out";
+        fs::create_directories(dest);
+        StaticArchive sa(path);
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+        for (size_t i = 1; i < infos.size(); i++) {
+            std::vector<FileInfo> one{infos[i]};
+            TS_ASSERT_THROWS(sa.extract(dest.string(), one), UnsafeNameException);
+        }
+        sa.extract(dest.string(), STATIC_FLAG_IGNORE_ERRORS);
+        TS_ASSERT(fs::exists(dest / "inside"));
+        TS_ASSERT(!fs::exists(temp / "escaped.txt"));
+        TS_ASSERT(!fs::exists(temp / "absolute.txt"));
+
+        // a single file is stored under its own name, not the path it was added from
+        fs::path file = dest / "inside";
+        StaticArchive added((temp / "added.arch").string(), ModeCreate);
+        TS_ASSERT_EQUALS(added.add(file.string()).files[0].name, "inside");
+    }
+
+    void testPreallocatedAdd() {
+        fs::path src = temp / "big";
+        fs::create_directories(src / "sub");
+        std::ofstream(src / "a", std::ofstream::binary) << std::string(100000, 'a');
+        std::ofstream(src / "sub" / "b", std::ofstream::binary) << std::string(3000, 'b');
+
+        std::string path = (temp / "prealloc.arch").string();
+        StaticArchive sa(path, ModeCreate, SizeMode32, STATIC_FLAG_WRITE_CRC32);
+        sa.add(src.string(), STATIC_FLAG_PREALLOCATE);
+        sa.close();
+
+        // preallocation must not move the end of the archive
+        uint64_t headers = (1 + 1 + 4 + 4) + (1 + 5 + 4 + 4);
+        TS_ASSERT_EQUALS(fs::file_size(path), STATIC_SIGNATURE_SIZE + DWORD + STATIC_EXTENSION_SIZE + headers + 103000u);
+
+        StaticArchive reader(path);
+        std::string data;
+        reader.read(reader.getFileInfo("sub/b"), data);
+        TS_ASSERT_EQUALS(data, std::string(3000, 'b'));
+    }
+
+    void testShuffleOrder() {
+        std::vector<size_t> a = shuffleOrder(100, 42, 0);
+        TS_ASSERT_EQUALS(a, shuffleOrder(100, 42, 0));
+        TS_ASSERT_DIFFERS(a, shuffleOrder(100, 42, 1));
+        TS_ASSERT_EQUALS(std::set<size_t>(a.begin(), a.end()).size(), 100u);
+
+        // every window of 10 stays together
+        std::vector<size_t> blocked = shuffleOrder(100, 42, 0, 10);
+        for (size_t i = 0; i < 100; i += 10) {
+            for (size_t j = i; j < i + 10; j++)
+                TS_ASSERT_EQUALS(blocked[j] / 10, blocked[i] / 10);
+        }
+    }
+
+    void testSampler() {
+        StaticArchive sa(makeArchive(50));
+        std::unique_ptr<Sampler> sampler = sa.sampler(7, 3, 4);
+
+        Sample sample;
+        std::set<std::string> seen;
+        while (sampler->next(sample)) {
+            TS_ASSERT_EQUALS(sample.data.size(), sample.info.size);
+            TS_ASSERT_EQUALS(sample.data[0], char('a' + std::stoi(sample.info.name) % 26));
+            seen.insert(sample.info.name);
+        }
+        TS_ASSERT_EQUALS(seen.size(), 50u);
+        TS_ASSERT_EQUALS(sampler->getPosition(), 50u);
+
+        // dropping a sampler in the middle of an epoch stops the prefetcher
+        sampler = sa.sampler(7, 4, 4);
+        TS_ASSERT(sampler->next(sample));
+        sampler.reset();
+    }
+
+    void testShards() {
+        StaticArchive sa(makeArchive(60));
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+
+        std::vector<Shard> shards = sa.getShards(4);
+        TS_ASSERT_EQUALS(shards.size(), 4u);
+
+        uint64_t entries = 0;
+        for (const Shard &shard : shards) {
+            TS_ASSERT_EQUALS(shard.firstEntry, entries);
+            entries += shard.count;
+
+            std::vector<FileInfo> part;
+            sa.getFileInfos(shard, part);
+            TS_ASSERT_EQUALS(part.size(), shard.count);
+            TS_ASSERT_EQUALS(part.front().name, infos[shard.firstEntry].name);
+            TS_ASSERT_EQUALS(part.back().dataOffset + part.back().size, shard.end);
+        }
+        TS_ASSERT_EQUALS(entries, 60u);
+
+        // payload sizes grow linearly, so the first shard holds the most entries
+        TS_ASSERT_LESS_THAN(shards[3].count, shards[0].count);
+        TS_ASSERT_LESS_THAN(shards[0].bytes, shards[3].bytes * 2);
+        TS_ASSERT_EQUALS(planShards({}, 3).size(), 3u);
+    }
+
+    void testReadBatch() {
+        StaticArchive sa(makeArchive(64));
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+
+        std::vector<FileInfo> wanted{infos[40], infos[1], infos[2], infos[1], infos[63]};
+        std::vector<std::string> storage;
+        std::vector<std::span<char>> buffers;
+        for (const FileInfo &info : wanted)
+            storage.emplace_back(info.size, '\0');
+        for (std::string &buffer : storage)
+            buffers.emplace_back(buffer.data(), buffer.size());
+
+        TS_ASSERT_EQUALS(sa.readBatch(wanted, buffers, 4), 41u + 2 + 3 + 2 + 64);
+        TS_ASSERT_EQUALS(storage[0], std::string(41, 'o'));
+        TS_ASSERT_EQUALS(storage[1], std::string(2, 'b'));
+        TS_ASSERT_EQUALS(storage[2], std::string(3, 'c'));
+        TS_ASSERT_EQUALS(storage[3], storage[1]);
+        TS_ASSERT_EQUALS(storage[4], std::string(64, 'l'));
+
+        buffers[0] = buffers[0].first(10);
+        TS_ASSERT_THROWS(sa.readBatch(wanted, buffers), std::invalid_argument);
+    }
+
+    void testBoundedQueue() {
+        BoundedQueue<int> queue(3);
+        TS_ASSERT_EQUALS(queue.getCapacity(), 4u);
+
+        for (int i = 0; i < 4; i++)
+            TS_ASSERT(queue.tryPush(i));
+        int value = 9;
+        TS_ASSERT(!queue.tryPush(value));
+
+        for (int i = 0; i < 4; i++) {
+            TS_ASSERT(queue.tryPop(value));
+            TS_ASSERT_EQUALS(value, i);
+        }
+        TS_ASSERT(!queue.tryPop(value));
+    }
+
+    void testLoader() {
+        StaticArchive sa(makeArchive(100));
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+
+        // a small queue forces the workers to wait for the consumer
+        Loader loader(sa, infos, 3, 2, 4, 5);
+        Sample sample;
+        std::set<std::string> seen;
+        while (loader.pop(sample)) {
+            TS_ASSERT_EQUALS(sample.data, std::string(sample.info.size, char('a' + std::stoi(sample.info.name) % 26)));
+            seen.insert(sample.info.name);
+        }
+        TS_ASSERT_EQUALS(seen.size(), 100u);
+        TS_ASSERT_EQUALS(loader.getDelivered(), 100u);
+
+        // several consumers, every file reaches exactly one of them
+        Loader shared(sa, infos, 2, 1, 4, 3);
+        std::vector<std::vector<std::string>> popped(4);
+        std::vector<std::thread> consumers;
+        for (std::vector<std::string> &names : popped) {
+            consumers.emplace_back([&shared, &names] {
+                Sample mine;
+                while (shared.pop(mine))
+                    names.push_back(mine.info.name);
+            });
+        }
+        for (std::thread &consumer : consumers)
+            consumer.join();
+        std::multiset<std::string> all;
+        for (const std::vector<std::string> &names : popped)
+            all.insert(names.begin(), names.end());
+        TS_ASSERT_EQUALS(all.size(), 100u);
+        TS_ASSERT_EQUALS(std::set<std::string>(all.begin(), all.end()).size(), 100u);
+        TS_ASSERT_EQUALS(shared.getDelivered(), 100u);
+
+        Loader stopped(sa, infos, 2, 1, 4);
+        TS_ASSERT(stopped.pop(sample));
+        stopped.stop();
+        TS_ASSERT(!stopped.pop(sample));
+    }
+
+    void testAccessPlan() {
+        StaticArchive sa(makeArchive(30));
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+
+        AccessPlan plan = sa.getAccessPlan({infos[20], infos[3], infos[11]}, 1);
+        TS_ASSERT_EQUALS(plan.getOrder().size(), 3u);
+        TS_ASSERT_THROWS_NOTHING(plan.advance(1));
+        TS_ASSERT_THROWS_NOTHING(plan.advance(10));
+
+        // hints never change what is read
+        std::string data;
+        sa.read(infos[3], data);
+        TS_ASSERT_EQUALS(data, std::string(4, 'd'));
+    }
+
+    void testFixedRecords() {
+        std::string path = (temp / "records.arch").string();
+        fs::path record = temp / "record";
+        {
+            StaticArchive sa(path, ModeCreate, Options{SizeModeFixed, STATIC_FLAG_WRITE_CRC32, 16});
+            for (int i = 0; i < 100; i++) {
+                std::ofstream(record, std::ofstream::binary) << std::string(16, char('a' + i % 26));
+                sa.add(record.string(), STATIC_FLAG_ONLY_NAMES);
+            }
+            std::ofstream(record, std::ofstream::binary) << "too short";
+            TS_ASSERT_THROWS(sa.add(record.string()), InvalidDataSizeException);
+        }
+        TS_ASSERT_THROWS(StaticArchive((temp / "empty.arch").string(), ModeCreate, Options{SizeModeFixed, 0, 0}),
+                         std::invalid_argument);
+
+        {
+            StaticArchive sa(path, ModeAppend);
+            TS_ASSERT_EQUALS(sa.getSizeMode(), SizeModeFixed);
+            TS_ASSERT_EQUALS(sa.getRecordSize(), 16u);
+            TS_ASSERT_EQUALS(sa.getFileCount(), 100u);
+
+            std::ofstream(record, std::ofstream::binary) << std::string(16, 'z');
+            sa.add(record.string());
+        }
+
+        StaticArchive sa(path);
+        TS_ASSERT_EQUALS(sa.getFileCount(), 101u);
+
+        FileInfo info = sa.getRecordInfo(30);
+        TS_ASSERT_EQUALS(info.dataOffset, info.offset);
+        TS_ASSERT_EQUALS(sa.getRecordInfo(31).dataOffset - info.dataOffset, 16u);
+        TS_ASSERT_EQUALS(info.name, "record");
+
+        std::string data;
+        sa.read(info, data);
+        TS_ASSERT_EQUALS(data, std::string(16, 'e'));
+        sa.read(sa.getRecordInfo(100), data);
+        TS_ASSERT_EQUALS(data, std::string(16, 'z'));
+        TS_ASSERT_THROWS(sa.getRecordInfo(101), std::out_of_range);
+
+        // without crcs the table only holds the names
+        std::string bare = (temp / "bare.arch").string();
+        {
+            StaticArchive writer(bare, ModeCreate, Options{SizeModeFixed, 0, 8});
+            std::ofstream(record, std::ofstream::binary) << std::string(8, 'x');
+            for (int i = 0; i < 10; i++)
+                writer.add(record.string(), STATIC_FLAG_ONLY_NAMES);
+        }
+        TS_ASSERT_EQUALS(fs::file_size(bare), STATIC_SIGNATURE_SIZE + 4 + STATIC_EXTENSION_SIZE + 80u + 10 * 7);
+    }
+
+    void testAlignment() {
+        std::string path = (temp / "aligned.arch").string();
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        for (int i = 0; i < 10; i++)
+            std::ofstream(src / std::to_string(i), std::ofstream::binary) << std::string(i * 37 + 1, char('a' + i));
+
+        {
+            StaticArchive sa(path, ModeCreate, Options{SizeMode32, STATIC_FLAG_WRITE_CRC32, 0, 64});
+            sa.add(src.string());
+        }
+        {
+            StaticArchive sa(path, ModeAppend);
+            std::ofstream(temp / "late", std::ofstream::binary) << "late";
+            sa.add((temp / "late").string(), STATIC_FLAG_ONLY_NAMES);
+        }
+
+        StaticArchive sa(path);
+        TS_ASSERT_EQUALS(sa.getAlignment(), 64u);
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+        TS_ASSERT_EQUALS(infos.size(), 11u);
+
+        std::vector<std::string> out;
+        sa.read(infos, out);
+        for (size_t i = 0; i < infos.size(); i++) {
+            TS_ASSERT_EQUALS(infos[i].dataOffset % 64, 0u);
+            if (infos[i].name != "late")
+                TS_ASSERT_EQUALS(out[i], std::string(std::stoi(infos[i].name) * 37 + 1, char('a' + std::stoi(infos[i].name))));
+        }
+
+        // records are padded to the alignment
+        std::string records = (temp / "aligned_records.arch").string();
+        {
+            StaticArchive writer(records, ModeCreate, Options{SizeModeFixed, 0, 10, 16});
+            std::ofstream(temp / "record", std::ofstream::binary) << std::string(10, 'r');
+            writer.add((temp / "record").string());
+            writer.add((temp / "record").string());
+        }
+        StaticArchive reader(records);
+        TS_ASSERT_EQUALS(reader.getRecordInfo(0).dataOffset % 16, 0u);
+        TS_ASSERT_EQUALS(reader.getRecordInfo(1).dataOffset - reader.getRecordInfo(0).dataOffset, 16u);
+        std::string data;
+        reader.read(reader.getRecordInfo(1), data);
+        TS_ASSERT_EQUALS(data, std::string(10, 'r'));
+
+        TS_ASSERT_THROWS(StaticArchive(path, ModeCreate, Options{SizeMode32, 0, 0, 12}), std::invalid_argument);
+    }
+
+    void testEmbeddedArchive() {
+        std::string path = makeArchive(300);
+        std::vector<FileInfo> infos;
+        StaticArchive(path).getFileInfos(infos);
+
+        std::vector<std::string_view> names;
+        for (const FileInfo &info : infos)
+            names.push_back(info.name);
+        PerfectHash hash = buildPerfectHash(names);
+
+        std::set<uint64_t> slots;
+        std::vector<EmbeddedEntry> entries(infos.size());
+        for (const FileInfo &info : infos) {
+            uint64_t slot = perfectHashSlot(info.name, hash);
+            slots.insert(slot);
+            entries[slot] = {info.name, info.dataOffset, info.size, info.crc};
+        }
+        TS_ASSERT_EQUALS(slots.size(), infos.size());
+        TS_ASSERT_LESS_THAN(*slots.rbegin(), infos.size());
+
+        std::ifstream file(path, std::ifstream::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        EmbeddedArchive archive(bytes.data(), bytes.size(), entries, hash.displacements, hash.seed);
+        for (int i : {0, 7, 299}) {
+            std::span<const uint8_t> data = archive.find(std::to_string(i));
+            TS_ASSERT_EQUALS(std::string(data.begin(), data.end()), std::string(i + 1, char('a' + i % 26)));
+        }
+        TS_ASSERT(archive.find("300").empty());
+        TS_ASSERT_EQUALS(archive.findEntry("missing"), nullptr);
+
+        std::string_view duplicates[] = {"a", "b", "a"};
+        TS_ASSERT_THROWS(buildPerfectHash(duplicates), std::invalid_argument);
+
+        // lookups in constant tables are evaluated at compile time
+        static constexpr uint8_t data[] = {'x', 'y', 'z'};
+        static constexpr EmbeddedEntry constantEntries[] = {{"xyz", 0, 3, 0}};
+        static constexpr uint32_t constantDisplacements[] = {0};
+        constexpr EmbeddedArchive constant(data, 3, constantEntries, constantDisplacements, 0);
+        static_assert(constant.find("xyz").size() == 3);
+        static_assert(constant.findEntry("abc") == nullptr);
+    }
+
+    void testMemoryArchive() {
+        std::string path = makeArchive(40, SizeMode16);
+        std::ifstream file(path, std::ifstream::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        MemoryArchive archive(bytes);
+        TS_ASSERT_EQUALS(archive.getFileCount(), 40u);
+        TS_ASSERT_EQUALS(archive.getSizeMode(), SizeMode16);
+
+        std::vector<MemoryEntry> entries;
+        archive.getEntries(entries);
+        TS_ASSERT_EQUALS(entries.size(), 40u);
+        for (const MemoryEntry &entry : entries) {
+            int i = std::stoi(std::string(entry.name));
+            TS_ASSERT_EQUALS(std::string(entry.data.begin(), entry.data.end()), std::string(i + 1, char('a' + i % 26)));
+            TS_ASSERT(entry.data.data() >= bytes.data() && entry.data.data() < bytes.data() + bytes.size());
+            TS_ASSERT_THROWS_NOTHING(archive.verify(entry));
+        }
+
+        StaticArchive sa(path);
+        MemoryEntry entry = archive.getEntry("17");
+        TS_ASSERT_EQUALS(entry.offset, sa.getFileInfo("17").offset);
+        TS_ASSERT_EQUALS(archive.view(sa.getFileInfo("17")).data(), entry.data.data());
+        TS_ASSERT_THROWS(archive.getEntry("missing"), EntryNotFoundException);
+
+        bytes[entry.data.data() - bytes.data()] ^= 1;
+        TS_ASSERT_THROWS(archive.verify(entry), ChecksumMismatchException);
+        TS_ASSERT_THROWS(sa.verify(sa.getFileInfo("17"), (const char*)entry.data.data()), ChecksumMismatchException);
+
+        // truncated memory is detected instead of read past
+        MemoryArchive truncated(std::span<const uint8_t>(bytes).first(bytes.size() - 10));
+        entries.clear();
+        TS_ASSERT_THROWS(truncated.getEntries(entries), std::out_of_range);
+        TS_ASSERT_THROWS(MemoryArchive(std::span<const uint8_t>(bytes).first(10)), InvalidSignatureException);
+
+        // aligned records with a name table
+        std::string records = (temp / "records.arch").string();
+        {
+            StaticArchive writer(records, ModeCreate, Options{SizeModeFixed, STATIC_FLAG_WRITE_CRC32, 5, 8});
+            for (char c : std::string("xyz")) {
+                std::ofstream(temp / std::string(1, c), std::ofstream::binary) << std::string(5, c);
+                writer.add((temp / std::string(1, c)).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+        }
+        std::ifstream recordFile(records, std::ifstream::binary);
+        bytes.assign(std::istreambuf_iterator<char>(recordFile), std::istreambuf_iterator<char>());
+        MemoryArchive fixed(bytes);
+        MemoryEntry record = fixed.getRecord(2);
+        TS_ASSERT_EQUALS(record.name, "z");
+        TS_ASSERT_EQUALS(std::string(record.data.begin(), record.data.end()), "zzzzz");
+        TS_ASSERT_EQUALS(record.offset % 8, 0u);
+        TS_ASSERT_THROWS_NOTHING(fixed.verify(record));
+        TS_ASSERT_EQUALS(fixed.getRecord(0).name, "x");
+        TS_ASSERT_THROWS(fixed.getRecord(3), std::out_of_range);
+        TS_ASSERT_EQUALS(fixed.getEntry("y").offset, StaticArchive(records).getRecordInfo(1).offset);
+    }
+
+    void testConstexprParse() {
+        // two entries without crcs in SizeMode16: "a" -> "x", "bc" -> "yz"
+        static constexpr uint8_t data[] = {0x91, 0xde, 0xee, 0x9c, 0x80, 0x5c, 0x23, 0xe6, 0, 0, 0, 0,
+                                           2, 0, 0, 0, 0, 0, 0, 0, SizeMode16, 0,
+                                           1, 'a', 1, 0, 'x', 2, 'b', 'c', 2, 0, 'y', 'z'};
+        static_assert(validateArchive(data) == 2);
+        static constexpr auto entries = parseEntries<validateArchive(data)>(data);
+        static_assert(findParsedEntry(data, entries, "bc").dataOffset == 32);
+        static_assert(findParsedEntry(data, entries, "a").size == 1);
+
+        // at runtime the walk matches the stream parser
+        std::string path = makeArchive(25, SizeMode64);
+        std::ifstream file(path, std::ifstream::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<FileInfo> infos;
+        StaticArchive(path).getFileInfos(infos);
+
+        ParsedSignature sig = parseSignature(bytes);
+        TS_ASSERT(sig.writeCrc);
+        size_t i = 0;
+        forEachEntry(bytes, sig, [&](const ParsedEntry &entry) {
+            TS_ASSERT(nameEquals(bytes, entry, infos[i].name));
+            TS_ASSERT_EQUALS(entry.offset, infos[i].offset);
+            TS_ASSERT_EQUALS(entry.dataOffset, infos[i].dataOffset);
+            TS_ASSERT_EQUALS(entry.crc, infos[i].crc);
+            i++;
+        });
+        TS_ASSERT_EQUALS(i, infos.size());
+
+        bytes.resize(bytes.size() - 1);
+        TS_ASSERT_THROWS(validateArchive(bytes), std::out_of_range);
+        bytes[0] = 0;
+        TS_ASSERT_THROWS(validateArchive(bytes), InvalidSignatureException);
+    }
+
+    void testNameIndex() {
+        // packed arrays cross their words
+        for (uint8_t bits : {1, 13, 33, 64}) {
+            std::vector<uint64_t> values;
+            for (uint64_t i = 0; i < 100; i++)
+                values.push_back(bits == 64 ? ~i : (i * 0x9e3779b97f4a7c15) >> (64 - bits));
+            std::vector<uint8_t> packed;
+            putPacked(packed, values, bits);
+            TS_ASSERT_EQUALS(packed.size(), packedSize(values.size(), bits));
+            for (uint64_t i = 0; i < values.size(); i++)
+                TS_ASSERT_EQUALS(parsePacked(packed, 0, i, bits), values[i]);
+        }
+
+        std::string path = (temp / "indexed.arch").string();
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        {
+            StaticArchive sa(path, ModeCreate, Options{SizeMode32, STATIC_FLAG_WRITE_CRC32, 0, 1, true});
+            for (int i = 0; i < 500; i++) {
+                std::ofstream(src / std::to_string(i), std::ofstream::binary) << std::string(i % 7 + 1, char('a' + i % 26));
+                sa.add((src / std::to_string(i)).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+            // a second entry of the same name is only reachable by a scan
+            std::ofstream(src / "7", std::ofstream::binary) << "late";
+            sa.add((src / "7").string(), STATIC_FLAG_ONLY_NAMES);
+        }
+
+        {
+            StaticArchive sa(path);
+            TS_ASSERT(sa.getIndexed());
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            // an 8 bit fingerprint and a 5 bit block per name, the hash and the block offsets add a few bits
+            TS_ASSERT_LESS_THAN(fs::file_size(path) - (infos.back().dataOffset + infos.back().size), infos.size() * 4);
+            for (int i : {0, 7, 123, 499}) {
+                FileInfo info = sa.getFileInfo(std::to_string(i));
+                TS_ASSERT_EQUALS(info.offset, infos[i].offset);
+                TS_ASSERT_EQUALS(info.dataOffset, infos[i].dataOffset);
+                TS_ASSERT_EQUALS(info.crc, infos[i].crc);
+            }
+            TS_ASSERT_THROWS(sa.getFileInfo("500"), EntryNotFoundException);
+            TS_ASSERT_THROWS(sa.getFileInfo("missing"), EntryNotFoundException);
+
+            // shards from the index blocks are the ones a scan plans at block granularity
+            for (size_t count : {1, 3, 7, 40}) {
+                std::vector<Shard> indexed = sa.getShards(count), scanned = planShards(infos, count, STATIC_INDEX_BLOCK);
+                TS_ASSERT_EQUALS(indexed.size(), scanned.size());
+                for (size_t i = 0; i < indexed.size(); i++) {
+                    TS_ASSERT_EQUALS(indexed[i].firstEntry, scanned[i].firstEntry);
+                    TS_ASSERT_EQUALS(indexed[i].count, scanned[i].count);
+                    TS_ASSERT_EQUALS(indexed[i].offset, scanned[i].offset);
+                    TS_ASSERT_EQUALS(indexed[i].end, scanned[i].end);
+                    TS_ASSERT_EQUALS(indexed[i].bytes, scanned[i].bytes);
+                }
+            }
+        }
+
+        // appending drops the index and rebuilds it on close
+        {
+            StaticArchive sa(path, ModeAppend);
+            std::ofstream(src / "new", std::ofstream::binary) << "new";
+            sa.add((src / "new").string(), STATIC_FLAG_ONLY_NAMES);
+        }
+        StaticArchive sa(path);
+        TS_ASSERT_EQUALS(sa.getFileCount(), 502u);
+        std::string data;
+        sa.read(sa.getFileInfo("new"), data);
+        TS_ASSERT_EQUALS(data, "new");
+        sa.read(sa.getFileInfo("42"), data);
+        TS_ASSERT_EQUALS(data, std::string(1, 'q'));
+
+        // records are indexed as well
+        std::string records = (temp / "indexed_records.arch").string();
+        {
+            StaticArchive writer(records, ModeCreate, Options{SizeModeFixed, STATIC_FLAG_WRITE_CRC32, 3, 1, true});
+            for (char c : std::string("uvw")) {
+                std::ofstream(src / std::string(1, c), std::ofstream::binary) << std::string(3, c);
+                writer.add((src / std::string(1, c)).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+        }
+        StaticArchive reader(records);
+        TS_ASSERT_EQUALS(reader.getFileInfo("v").offset, reader.getRecordInfo(1).offset);
+        TS_ASSERT_THROWS(reader.getFileInfo("x"), EntryNotFoundException);
+    }
+
+    void testAttachedArchive() {
+        std::string path = (temp / "attached.arch").string();
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        {
+            StaticArchive sa(path, ModeCreate, Options{SizeMode32, STATIC_FLAG_WRITE_CRC32, 0, 64, true});
+            for (int i = 0; i < 20; i++) {
+                std::ofstream(src / std::to_string(i), std::ofstream::binary) << std::string(i + 1, char('a' + i));
+                sa.add((src / std::to_string(i)).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+        }
+
+        std::string host = (temp / "host.bin").string();
+        std::ofstream(host, std::ofstream::binary) << std::string(1000, 'h');
+        ArchiveLocation location = attachArchive(host, path);
+        TS_ASSERT_EQUALS(location.offset, 4096u);
+        TS_ASSERT_EQUALS(location.size, fs::file_size(path));
+
+        std::optional<ArchiveLocation> found = locateArchive(File(host, O_RDONLY));
+        TS_ASSERT(found.has_value());
+        TS_ASSERT_EQUALS(found->offset, location.offset);
+        TS_ASSERT(!locateArchive(File(path, O_RDONLY)).has_value());
+
+        // found through the trailer, offsets are file offsets
+        StaticArchive sa(host);
+        TS_ASSERT_EQUALS(sa.getBaseOffset(), 4096u);
+        TS_ASSERT_EQUALS(sa.getFileCount(), 20u);
+        FileInfo info = sa.getFileInfo("5");
+        TS_ASSERT_EQUALS(info.dataOffset % 64, 0u);
+        std::string data;
+        sa.read(info, data);
+        TS_ASSERT_EQUALS(data, std::string(6, 'f'));
+
+        StaticArchive explicitBase(host, location.offset);
+        std::vector<FileInfo> infos;
+        explicitBase.getFileInfos(infos);
+        TS_ASSERT_EQUALS(infos[5].dataOffset, info.dataOffset);
+
+        MappedArchive mapped(host);
+        TS_ASSERT_EQUALS(mapped.getBaseOffset(), 4096u);
+        MemoryEntry entry = mapped.getArchive().getEntry("19");
+        TS_ASSERT_EQUALS(std::string(entry.data.begin(), entry.data.end()), std::string(20, 't'));
+        TS_ASSERT_EQUALS(entry.offset + location.offset, sa.getFileInfo("19").offset);
+
+        // released pages of a mapping are read again from the file
+        std::vector<MemoryEntry> entries;
+        mapped.getArchive().getEntries(entries);
+        std::reverse(entries.begin(), entries.end());
+        {
+            AccessPlan plan = mapped.getAccessPlan(entries, 64);
+            TS_ASSERT_EQUALS(plan.getOrder()[0].dataOffset + location.offset, sa.getFileInfo("19").dataOffset);
+            plan.advance(entries.size());
+        }
+        TS_ASSERT_EQUALS(std::string(entry.data.begin(), entry.data.end()), std::string(20, 't'));
+
+        // padding beyond the copy buffer is zeroed as well
+        std::string wide = (temp / "wide.bin").string();
+        std::ofstream(wide, std::ofstream::binary) << std::string(1000, 'w');
+        ArchiveLocation far = attachArchive(wide, path, 1 << 20);
+        TS_ASSERT_EQUALS(far.offset, 1u << 20);
+        static_assert((1 << 20) > STATIC_BUFFER_SIZE);
+        std::ifstream padded(wide, std::ifstream::binary);
+        std::string head(far.offset, '\0');
+        padded.read(head.data(), (std::streamsize)head.size());
+        TS_ASSERT_EQUALS(head.find_first_not_of('\0', 1000), std::string::npos);
+        TS_ASSERT_EQUALS(StaticArchive(wide).getFileCount(), 20u);
+
+        std::ofstream(temp / "plain.bin", std::ofstream::binary) << std::string(100, 'p');
+        TS_ASSERT_THROWS(StaticArchive((temp / "plain.bin").string()), InvalidSignatureException);
+    }
+
+    void testAppendResume() {
+        // the extension records where the entries end, without it (a legacy
+        // signature) the entries counted by the signature are scanned
+        for (bool legacy : {false, true}) {
+            std::string path = (temp / "resume.arch").string();
+            fs::path src = temp / "src";
+            fs::create_directories(src);
+            auto add = [&](StaticArchive &sa, const std::string &name) {
+                std::ofstream(src / name, std::ofstream::binary) << name;
+                sa.add((src / name).string(), STATIC_FLAG_ONLY_NAMES);
+            };
+            {
+                Options options{SizeMode16, STATIC_FLAG_WRITE_CRC32, 0, legacy ? 1u : 8u};
+                options.legacySignature = legacy;
+                StaticArchive sa(path, ModeCreate, options);
+                add(sa, "first");
+                add(sa, "second");
+            }
+            {
+                StaticArchive sa(path, ModeAppend);
+                add(sa, "third");
+            }
+
+            // an interrupted append leaves bytes that no header accounts for
+            std::ofstream(path, std::ofstream::binary | std::ofstream::app) << std::string(13, 'x');
+            {
+                StaticArchive sa(path, ModeAppend);
+                add(sa, "fourth");
+            }
+
+            StaticArchive sa(path);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), 4u);
+            TS_ASSERT_EQUALS(fs::file_size(path), infos.back().dataOffset + infos.back().size);
+            for (const FileInfo &info : infos) {
+                std::string data;
+                sa.read(info, data);
+                TS_ASSERT_EQUALS(data, info.name);
+            }
+        }
+
+        // archives without options record their end as well
+        std::string plain = (temp / "default.arch").string();
+        StaticArchive(plain, ModeCreate, SizeMode32, STATIC_FLAG_WRITE_CRC32).close();
+        char signature[STATIC_SIGNATURE_SIZE];
+        std::ifstream(plain, std::ifstream::binary).read(signature, STATIC_SIGNATURE_SIZE);
+        TS_ASSERT(signature[21] & STATIC_SIG_EXTENDED);
+
+        Options indexed{SizeMode32};
+        indexed.index = true;
+        indexed.legacySignature = true;
+        TS_ASSERT_THROWS(StaticArchive((temp / "legacy.arch").string(), ModeCreate, indexed), std::invalid_argument);
+    }
+
+    void testVarintSizes() {
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        std::vector<uint64_t> sizes = {0, 1, 127, 128, 16383, 16384, 300000};
+        auto build = [&](const std::string &name, SizeMode sizeMode) {
+            std::string path = (temp / name).string();
+            StaticArchive sa(path, ModeCreate, sizeMode, STATIC_FLAG_WRITE_CRC32);
+            for (uint64_t size : sizes) {
+                std::ofstream(src / std::to_string(size), std::ofstream::binary) << std::string(size, char('a' + size % 26));
+                sa.add((src / std::to_string(size)).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+            return path;
+        };
+        std::string varint = build("varint.arch", SizeModeVarint);
+        // 1 + 1 + 1 + 2 + 2 + 3 + 3 size bytes instead of 7 * 8
+        TS_ASSERT_EQUALS(fs::file_size(build("wide.arch", SizeMode64)) - fs::file_size(varint), 56u - 13u);
+
+        StaticArchive sa(varint);
+        TS_ASSERT_EQUALS(sa.getSizeMode(), SizeModeVarint);
+        std::vector<FileInfo> infos;
+        sa.getFileInfos(infos);
+        TS_ASSERT_EQUALS(infos.size(), sizes.size());
+        for (size_t i = 0; i < sizes.size(); i++) {
+            TS_ASSERT_EQUALS(infos[i].size, sizes[i]);
+            std::string data;
+            TS_ASSERT_THROWS_NOTHING(sa.read(infos[i], data));
+        }
+
+        std::ifstream file(varint, std::ifstream::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<MemoryEntry> entries;
+        MemoryArchive(bytes).getEntries(entries);
+        for (size_t i = 0; i < sizes.size(); i++)
+            TS_ASSERT_EQUALS(entries[i].data.size(), sizes[i]);
+
+        // the word decoder and the bytewise fallback agree
+        static constexpr uint8_t longVarint[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+        static_assert([] { uint64_t offset = 0; return parseVarint(longVarint, offset); }() == 0xffffffffffffffff);
+        static constexpr uint8_t padded[] = {0xe5, 0x8e, 0x26, 0, 0, 0, 0, 0};
+        static_assert([] { uint64_t offset = 0; return parseVarint(padded, offset); }() == 624485);
+        static_assert([] { uint64_t offset = 0; parseVarint(padded, offset); return offset; }() == 3);
+        static constexpr uint8_t tail[] = {0xe5, 0x8e, 0x26};
+        static_assert([] { uint64_t offset = 0; return parseVarint(tail, offset); }() == 624485);
+
+        // sizes beyond 64 bits are malformed, not wrapped
+        uint64_t offset = 0;
+        uint8_t overLong[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02};
+        TS_ASSERT_THROWS(parseVarint(overLong, offset), std::out_of_range);
+        offset = 0;
+        uint8_t elevenBytes[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+        TS_ASSERT_THROWS(parseVarint(elevenBytes, offset), std::out_of_range);
+    }
+
+    void testFrontCodedNames() {
+        fs::path tree = temp / "tree";
+        for (int c = 0; c < 10; c++) {
+            fs::path dir = tree / "train" / ("class_00" + std::to_string(400 + c));
+            fs::create_directories(dir);
+            for (int i = 0; i < 20; i++)
+                std::ofstream(dir / ("img_000" + std::to_string(100 + i) + ".jpg"), std::ofstream::binary) << c << "/" << i;
+        }
+
+        std::string plain = (temp / "plain.arch").string();
+        std::string coded = (temp / "coded.arch").string();
+        std::vector<FileInfo> expected;
+        {
+            StaticArchive sa(plain, ModeCreate, Options{SizeMode16, STATIC_FLAG_WRITE_CRC32, 0, 1, true, false});
+            expected = sa.add(tree.string()).files;
+        }
+        {
+            StaticArchive sa(coded, ModeCreate, Options{SizeMode16, STATIC_FLAG_WRITE_CRC32, 0, 1, true, true});
+            sa.add(tree.string());
+        }
+        // most of "train/class_00400/img_000100.jpg" is shared with the entry in front
+        TS_ASSERT_LESS_THAN(fs::file_size(coded) + 200 * 20, fs::file_size(plain));
+
+        {
+            StaticArchive sa(coded);
+            TS_ASSERT(sa.getFrontCoded());
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), expected.size());
+            for (size_t i = 0; i < infos.size(); i++) {
+                TS_ASSERT_EQUALS(infos[i].name, expected[i].name);
+                TS_ASSERT_EQUALS(infos[i].crc, expected[i].crc);
+            }
+
+            // the index points to restart entries
+            for (size_t i : {0, 1, 15, 16, 17, 199}) {
+                FileInfo info = sa.getFileInfo(expected[i].name);
+                TS_ASSERT_EQUALS(info.offset, infos[i].offset);
+            }
+            TS_ASSERT_THROWS(sa.getFileInfo("train/class_00400/img_000999.jpg"), EntryNotFoundException);
+
+            std::vector<FileInfo> sharded;
+            for (const Shard &shard : sa.getShards(3)) {
+                TS_ASSERT_EQUALS(shard.firstEntry % STATIC_NAME_RESTART, 0u);
+                sa.getFileInfos(shard, sharded);
+            }
+            TS_ASSERT_EQUALS(sharded.size(), infos.size());
+            TS_ASSERT_EQUALS(sharded.back().name, infos.back().name);
+        }
+
+        {
+            StaticArchive sa(coded, ModeAppend);
+            std::ofstream(temp / "extra.jpg", std::ofstream::binary) << "extra";
+            sa.add((temp / "extra.jpg").string());
+        }
+        StaticArchive sa(coded);
+        std::string data;
+        sa.read(sa.getFileInfo("extra.jpg"), data);
+        TS_ASSERT_EQUALS(data, "extra");
+        TS_ASSERT_THROWS_NOTHING(sa.read(sa.getFileInfo(expected[37].name), data));
+        TS_ASSERT_EQUALS(data.size(), expected[37].size);
+
+        std::ifstream file(coded, std::ifstream::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        TS_ASSERT_THROWS(MemoryArchive{bytes}, std::invalid_argument);
+    }
+
+    void testColumnLayout() {
+        fs::path src = temp / "small";
+        fs::create_directories(src);
+        std::vector<std::string> names;
+        for (int i = 0; i < 40; i++) {
+            names.push_back("f" + std::to_string(i));
+            // a few empty entries share their offset with the next one
+            std::ofstream(src / names.back(), std::ofstream::binary) << std::string(i % 7 == 3 ? 0 : i * 3 + 1, char('a' + i % 26));
+        }
+
+        for (uint32_t alignment : {1u, 64u}) {
+            std::string path = (temp / ("columns" + std::to_string(alignment) + ".arch")).string();
+            {
+                StaticArchive sa(path, ModeCreate, Options{SizeModeColumns, STATIC_FLAG_WRITE_CRC32, 0, alignment, true});
+                for (int i = 0; i < 30; i++)
+                    sa.add((src / names[i]).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+            {
+                StaticArchive sa(path, ModeAppend);
+                for (int i = 30; i < 40; i++)
+                    sa.add((src / names[i]).string(), STATIC_FLAG_ONLY_NAMES);
+            }
+
+            StaticArchive sa(path);
+            TS_ASSERT_EQUALS(sa.getSizeMode(), SizeModeColumns);
+            TS_ASSERT_EQUALS(sa.getFileCount(), 40u);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            for (size_t i = 0; i < infos.size(); i++) {
+                TS_ASSERT_EQUALS(infos[i].name, names[i]);
+                TS_ASSERT_EQUALS(infos[i].size, fs::file_size(src / names[i]));
+                TS_ASSERT_EQUALS(infos[i].dataOffset % alignment, 0u);
+                TS_ASSERT_EQUALS(sa.getRecordInfo(i).dataOffset, infos[i].dataOffset);
+
+                std::string data;
+                TS_ASSERT_THROWS_NOTHING(sa.read(sa.getFileInfo(names[i]), data));
+                TS_ASSERT_EQUALS(data, std::string(infos[i].size, char('a' + i % 26)));
+            }
+            TS_ASSERT_THROWS(sa.getFileInfo("missing"), EntryNotFoundException);
+
+            std::ifstream file(path, std::ifstream::binary);
+            std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            MemoryArchive memory(bytes);
+            TS_ASSERT_EQUALS(memory.getEntry("f38").data.size(), infos[38].size);
+            TS_ASSERT_EQUALS(memory.getEntry("f38").offset, infos[38].dataOffset);
+            TS_ASSERT_THROWS_NOTHING(memory.verify(memory.getEntry("f38")));
+        }
+
+        TS_ASSERT_THROWS(StaticArchive((temp / "coded.arch").string(), ModeCreate,
+                                       Options{SizeModeColumns, 0, 0, 1, false, true}), std::invalid_argument);
+    }
+
+    void testTransactionRecovery() {
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        for (int i = 0; i < 6; i++)
+            std::ofstream(src / ("e" + std::to_string(i)), std::ofstream::binary) << std::string(100 + i, char('a' + i));
+
+        for (auto [flags, frontCoded] : {std::pair{(uint8_t)STATIC_FLAG_WRITE_CRC32, false},
+                                         std::pair{(uint8_t)STATIC_FLAG_WRITE_CRC32, true},
+                                         std::pair{(uint8_t)0, false}}) {
+            std::string committed = (temp / "committed.arch").string();
+            std::string path = (temp / "crashed.arch").string();
+            for (const std::string &target : {committed, path}) {
+                Options options{SizeMode32, flags, 0, 16};
+                options.frontCodedNames = frontCoded;
+                StaticArchive sa(target, ModeCreate, options);
+                for (int i = 0; i < (target == path ? 5 : 3); i++)
+                    sa.add((src / ("e" + std::to_string(i))).string(), STATIC_FLAG_ONLY_NAMES);
+                sa.commit();
+            }
+
+            // the crash happened before the commit record of the last two entries,
+            // while the header of another one was written
+            std::vector<char> signature(STATIC_SIGNATURE_SIZE + DWORD + STATIC_EXTENSION_SIZE);
+            std::ifstream(committed, std::ifstream::binary).read(signature.data(), (std::streamsize)signature.size());
+            {
+                std::fstream file(path, std::fstream::binary | std::fstream::in | std::fstream::out);
+                file.write(signature.data(), (std::streamsize)signature.size());
+                file.seekp(0, std::fstream::end);
+                file << '\x02' << "e5";
+            }
+            {
+                StaticArchive sa(path);
+                TS_ASSERT_EQUALS(sa.getFileCount(), 3u);
+            }
+            {
+                StaticArchive sa(path, ModeAppend);
+                // only entries with a crc can be told apart from torn ones
+                TS_ASSERT_EQUALS(sa.getFileCount(), flags ? 5u : 3u);
+                sa.add((src / "e5").string(), STATIC_FLAG_ONLY_NAMES);
+                sa.commit();
+            }
+
+            StaticArchive sa(path);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), flags ? 6u : 4u);
+            TS_ASSERT_EQUALS(fs::file_size(path), infos.back().dataOffset + infos.back().size);
+            TS_ASSERT_EQUALS(infos.back().name, "e5");
+            for (const FileInfo &info : infos) {
+                std::string data;
+                sa.read(info, data);
+                TS_ASSERT_EQUALS(data, std::string(info.size, info.name[1] - '0' + 'a'));
+            }
+        }
+
+        // legacy signatures store no end, the signature alone tells what was committed
+        std::string plain = (temp / "plain.arch").string();
+        {
+            Options legacy{SizeMode32};
+            legacy.legacySignature = true;
+            StaticArchive sa(plain, ModeCreate, legacy);
+            for (int i = 0; i < 3; i++)
+                sa.add((src / ("e" + std::to_string(i))).string(), STATIC_FLAG_ONLY_NAMES);
+            sa.commit();
+        }
+        std::ofstream(plain, std::ofstream::binary | std::ofstream::app) << '\x02' << "e3";
+        {
+            StaticArchive sa(plain, ModeAppend);
+            TS_ASSERT_EQUALS(sa.getFileCount(), 3u);
+            sa.add((src / "e4").string(), STATIC_FLAG_ONLY_NAMES);
+        }
+        {
+            StaticArchive sa(plain);
+            std::string data;
+            sa.read(sa.getFileInfo("e4"), data);
+            TS_ASSERT_EQUALS(data, std::string(104, 'e'));
+            TS_ASSERT_EQUALS(sa.getFileCount(), 4u);
+        }
+
+        // the table of archives without headers is overwritten by appends
+        StaticArchive columns((temp / "columns.arch").string(), ModeCreate, Options{SizeModeColumns});
+        TS_ASSERT_THROWS(columns.commit(), std::logic_error);
+        Options durable{SizeModeFixed, 0, 8};
+        durable.durability = DurabilityClose;
+        TS_ASSERT_THROWS(StaticArchive((temp / "fixed.arch").string(), ModeCreate, durable), std::invalid_argument);
+
+        StaticArchive sa((temp / "committed.arch").string());
+        TS_ASSERT_THROWS(sa.commit(), ReadOnlyException);
+    }
+
+    void testDurability() {
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        std::ofstream(src / "entry", std::ofstream::binary) << std::string(300, 'd');
+        std::string path = (temp / "durable.arch").string();
+        auto committed = [&path] { return StaticArchive(path).getFileCount(); };
+
+        {
+            Options options{SizeMode32, STATIC_FLAG_WRITE_CRC32};
+            options.durability = DurabilityPeriodic;
+            options.syncBytes = 1000;
+            StaticArchive sa(path, ModeCreate, options);
+            // about 311 bytes per entry, the fourth one reaches the limit
+            for (int i = 0; i < 5; i++)
+                sa.add((src / "entry").string(), STATIC_FLAG_ONLY_NAMES);
+            TS_ASSERT_EQUALS(committed(), 4u);
+        }
+        TS_ASSERT_EQUALS(committed(), 5u);
+
+        {
+            Options options;
+            options.durability = DurabilityPeriodic;
+            options.syncInterval = std::chrono::milliseconds(5);
+            StaticArchive sa(path, ModeAppend, options);
+            sa.add((src / "entry").string(), STATIC_FLAG_ONLY_NAMES);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            sa.add((src / "entry").string(), STATIC_FLAG_ONLY_NAMES);
+            TS_ASSERT_EQUALS(committed(), 7u);
+        }
+
+        {
+            Options options;
+            options.durability = DurabilityClose;
+            StaticArchive sa(path, ModeAppend, options);
+            sa.add((src / "entry").string(), STATIC_FLAG_ONLY_NAMES);
+            TS_ASSERT_EQUALS(committed(), 7u);
+        }
+        TS_ASSERT_EQUALS(committed(), 8u);
+    }
+
+    void testGatherAppend() {
+        fs::path src = temp / "src";
+        fs::create_directories(src);
+        std::ofstream(src / "plain", std::ofstream::binary) << std::string(28, 'p');
+
+        std::string head = "head:", body(18, 'b'), foot = ":foot";
+        std::vector<iovec> segments{{head.data(), head.size()}, {nullptr, 0}, {body.data(), body.size()},
+                                    {foot.data(), foot.size()}};
+        for (SizeMode sizeMode : {SizeMode32, SizeModeFixed, SizeModeColumns}) {
+            std::string path = (temp / "gather.arch").string();
+            {
+                StaticArchive sa(path, ModeCreate, Options{sizeMode, STATIC_FLAG_WRITE_CRC32, 28, 8, false,
+                                                           sizeMode == SizeMode32});
+                FileInfo info = sa.append("gathered", segments);
+                TS_ASSERT_EQUALS(info.size, 28u);
+                sa.add((src / "plain").string(), STATIC_FLAG_ONLY_NAMES);
+                sa.append("again", segments);
+            }
+
+            StaticArchive sa(path);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), 3u);
+            std::string data;
+            sa.read(infos[0], data);
+            TS_ASSERT_EQUALS(data, head + body + foot);
+            sa.read(infos[1], data);
+            TS_ASSERT_EQUALS(data, std::string(28, 'p'));
+            TS_ASSERT_EQUALS(infos[2].name, "again");
+            TS_ASSERT_EQUALS(infos[2].dataOffset % 8, 0u);
+            sa.read(infos[2], data);
+            TS_ASSERT_EQUALS(data, head + body + foot);
+        }
+    }
+
+    void testTypedData() {
+        struct Point {
+            float x, y;
+            int64_t id;
+        };
+        std::vector<float> floats{1.5f, -2.25f, 3.0f, 1e30f};
+        std::array<int64_t, 3> ints{-1, 1ll << 40, 7};
+        Point point{0.5f, 2.0f, 42};
+
+        std::string path = (temp / "typed.arch").string();
+        {
+            std::fstream file(path, std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+            // without a file path the stream is written instead
+            StaticArchive sa(&file, ModeCreate, SizeMode64, STATIC_FLAG_WRITE_CRC32);
+            sa.append("floats", floats);
+            sa.append("ints", std::span<const int64_t>(ints));
+            sa.append("point", &point);
+            sa.append("text", std::string("plain"));
+            // strings and arrays are ranges, never a single character
+            sa.append("literal", std::string_view("abc"));
+            sa.append("array", "abc");
+        }
+        static_assert(!SingleObject<const char> && !SingleObject<int[2]> && SingleObject<Point>);
+
+        StaticArchive sa(path);
+        std::vector<float> readFloats;
+        TS_ASSERT_EQUALS(sa.read(sa.getFileInfo("floats"), readFloats), floats.size() * sizeof(float));
+        TS_ASSERT_EQUALS(readFloats, floats);
+
+        std::array<int64_t, 3> readInts{};
+        sa.read(sa.getFileInfo("ints"), std::span<int64_t>(readInts));
+        TS_ASSERT_EQUALS(readInts, ints);
+        std::array<int64_t, 2> small{};
+        TS_ASSERT_THROWS(sa.read(sa.getFileInfo("ints"), std::span<int64_t>(small)), std::invalid_argument);
+
+        Point readPoint{};
+        sa.read(sa.getFileInfo("point"), &readPoint);
+        TS_ASSERT_EQUALS(readPoint.id, 42);
+        TS_ASSERT_EQUALS(readPoint.y, 2.0f);
+        // any other entry would overflow the point
+        TS_ASSERT_THROWS(sa.read(sa.getFileInfo("ints"), &readPoint), std::invalid_argument);
+
+        // 5 bytes are no whole number of floats
+        std::vector<float> wrong;
+        TS_ASSERT_THROWS(sa.read(sa.getFileInfo("text"), wrong), std::invalid_argument);
+        std::string text;
+        sa.read(sa.getFileInfo("text"), text);
+        TS_ASSERT_EQUALS(text, "plain");
+        TS_ASSERT_EQUALS(sa.getFileInfo("literal").size, 3u);
+        TS_ASSERT_EQUALS(sa.getFileInfo("array").size, 4u);
+    }
+
+    void testAutoSizeMode() {
+        fs::path small = temp / "small", large = temp / "large";
+        fs::create_directories(small);
+        fs::create_directories(large);
+        for (int i = 0; i < 10; i++)
+            std::ofstream(small / std::to_string(i), std::ofstream::binary) << std::string(100 * i, 's');
+        std::ofstream(large / "big", std::ofstream::binary) << std::string(70000, 'l');
+        std::ofstream(large / "tiny", std::ofstream::binary) << "t";
+
+        std::string path = (temp / "auto.arch").string();
+        {
+            StaticArchive sa(path, ModeCreate, SizeMode64, STATIC_FLAG_WRITE_CRC32);
+            AddResult result = sa.add(small.string(), STATIC_FLAG_AUTO_SIZE_MODE);
+            TS_ASSERT_EQUALS(sa.getSizeMode(), SizeMode16);
+            TS_ASSERT_EQUALS(result.sizeMode, SizeMode16);
+            TS_ASSERT_EQUALS(result.files.size(), 10u);
+            TS_ASSERT_EQUALS(result.dataBytes, 4500u);
+            // name size, one character, crc and a 16 bit size per entry
+            TS_ASSERT_EQUALS(result.headerBytes, 10u * (1 + 1 + 4 + 2));
+            // the entries fix the mode from now on
+            TS_ASSERT_THROWS(sa.add(large.string(), STATIC_FLAG_AUTO_SIZE_MODE), InvalidDataSizeException);
+            TS_ASSERT_EQUALS(sa.getFileCount(), 10u);
+        }
+        {
+            StaticArchive sa(path);
+            TS_ASSERT_EQUALS(sa.getSizeMode(), SizeMode16);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), 10u);
+            std::string data;
+            for (const FileInfo &info : infos)
+                TS_ASSERT_THROWS_NOTHING(sa.read(info, data));
+        }
+
+        StaticArchive sa(path, ModeCreate, SizeMode16, STATIC_FLAG_WRITE_CRC32);
+        sa.add(large.string(), STATIC_FLAG_AUTO_SIZE_MODE);
+        TS_ASSERT_EQUALS(sa.getSizeMode(), SizeMode32);
+        TS_ASSERT_EQUALS(sa.getFileCount(), 2u);
+        static_assert(fittingSizeMode(0xffff) == SizeMode16 && fittingSizeMode(0x100000000) == SizeMode64);
+    }
+
+    void testHeaderScan() {
+        using Codec = HeaderCodec<SizeMode16, true, false>;
+        static_assert(Codec::maxSize == 1 + 255 + 4 + 2);
+        static_assert(withHeaderCodec(SizeModeVarint, false, true, []<typename C>(C) { return C::maxSize; }) ==
+                      1 + 1 + 255 + VARINT_MAX);
+
+        // headers cross the scan windows, some payloads span several windows
+        for (bool coded : {false, true}) {
+            std::string path = (temp / "scan.arch").string();
+            std::vector<FileInfo> expected;
+            {
+                StaticArchive sa(path, ModeCreate, Options{SizeModeVarint, STATIC_FLAG_WRITE_CRC32, 0, 8, false, coded});
+                for (int i = 0; i < 3000; i++) {
+                    std::string name = "entries/" + std::string(i % 200, 'n') + std::to_string(i);
+                    expected.push_back(sa.append(name, std::string(i % 97 == 0 ? 40000 : i % 13, 'x')));
+                }
+            }
+
+            StaticArchive sa(path);
+            std::vector<FileInfo> infos;
+            sa.getFileInfos(infos);
+            TS_ASSERT_EQUALS(infos.size(), expected.size());
+            for (size_t i = 0; i < infos.size(); i++) {
+                TS_ASSERT_EQUALS(infos[i].name, expected[i].name);
+                TS_ASSERT_EQUALS(infos[i].size, expected[i].size);
+                TS_ASSERT_EQUALS(infos[i].crc, expected[i].crc);
+                TS_ASSERT_EQUALS(infos[i].dataOffset, expected[i].dataOffset);
+            }
+        }
+    }
+
+    void testSharedArchive() {
+        std::string path = (temp / "shared.arch").string();
+        {
+            StaticArchive sa(path, ModeCreate, Options{SizeMode32, STATIC_FLAG_WRITE_CRC32, 0, 1, false, true});
+            for (int i = 0; i < 500; i++)
+                sa.append("shared/" + std::to_string(i), std::string(i * 7, (char)('a' + i % 26)));
+            sa.append("shared/0", std::string("duplicate"));
+        }
+
+        std::shared_ptr<const SharedArchive> archive = SharedArchive::open(path);
+        TS_ASSERT_EQUALS(archive->getFileCount(), 501u);
+        // the first entry of a name wins, like a scan
+        TS_ASSERT_EQUALS(archive->getFileInfo("shared/0").size, 0u);
+        TS_ASSERT(archive->findFileInfo("missing") == nullptr);
+        TS_ASSERT_THROWS(archive->getFileInfo("missing"), EntryNotFoundException);
+
+        std::atomic<uint64_t> mismatches = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([archive, t, &mismatches] {
+                ArchiveCursor cursor(archive);
+                for (int i = 0; i < 500; i++) {
+                    int n = (i * 31 + t * 17) % 500;
+                    std::span<const char> data = cursor.read("shared/" + std::to_string(n));
+                    if (std::string_view(data.data(), data.size()) != std::string(n * 7, (char)('a' + n % 26)))
+                        mismatches++;
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        TS_ASSERT_EQUALS(mismatches.load(), 0u);
+        TS_ASSERT_EQUALS(archive.use_count(), 1);
+
+        // corrupt a payload, every cursor sees it
+        FileInfo info = archive->getFileInfo("shared/100");
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp((std::streamoff)info.dataOffset);
+            f.put('!');
+        }
+        ArchiveCursor cursor(archive);
+        std::string out;
+        TS_ASSERT_THROWS(cursor.read(info, out), ChecksumMismatchException);
+        TS_ASSERT(archive->getChecks());
+        TS_ASSERT(!SharedArchive::open(path, STATIC_FLAG_DISABLE_CHECKS)->getChecks());
+        TS_ASSERT_THROWS_NOTHING(ArchiveCursor(SharedArchive::open(path, STATIC_FLAG_DISABLE_CHECKS)).read(info, out));
+    }
+};
+
 #endif //STATICARCHIVE_TESTSUITE1_H
@@ -38,9 +38,12 @@ struct EntryHeader {
 import io
 import os
 import shutil
+import struct
 import zlib
 import enum
+import queue
 import argparse
+import threading
 import functools
 import dataclasses
 
@@ -62,7 +65,10 @@ _decode = lambda d: int.from_bytes(d, BYTEORDER, signed=False)
 MAGIC = b'\x91\xde\xee\x9c\x80\x5c\x23\xe6'
 MODE_MASK = 0b1100_0000
 CRC_MASK  = 0b0010_0000
+SIG_CRC = 0b01
+SIG_EXTENDED = 0b10
 CONV_MODE = [WORD, DWORD, QWORD]
+STRUCT_MODE = ['H', 'I', 'Q']
 READ_OFFSET = len(MAGIC) + DWORD + QWORD + BYTE + BYTE
 
 
@@ -112,7 +118,7 @@ def parse_args():
     """)
     parser.add_argument('-s', '--source', dest='src', required=False, help='Input files or directories.')
 
-    mode_group = parser.add_argument_group('Size Mode')
+    mode_group = parser.add_argument_group('Size Mode', 'Without one, create picks the smallest that fits.')
     mode_group.add_argument('-M16', dest='M16', action='store_true', help='For 16 bit mode.')
     mode_group.add_argument('-M32', dest='M32', action='store_true', help='For 32 bit mode.')
     mode_group.add_argument('-M64', dest='M64', action='store_true', help='For 64 bit mode.')
@@ -153,6 +159,11 @@ class SizeMode(enum.IntEnum):
     m32 = 1
     m64 = 2
 
+    @staticmethod
+    def fitting(size: int) -> 'SizeMode':
+        """ The smallest mode whose size field holds size. """
+        return SizeMode.m16 if size <= 0xFFFF else SizeMode.m32 if size <= 0xFFFF_FFFF else SizeMode.m64
+
 
 @dataclasses.dataclass
 class FileInfo:
@@ -163,6 +174,15 @@ class FileInfo:
     data_offset: int  # offset to data
 
 
+@dataclasses.dataclass
+class AddResult:
+    """ What add appended, and the header bytes it projected (in the size mode it picked). """
+    files: List[FileInfo]
+    size_mode: SizeMode
+    header_bytes: int
+    data_bytes: int
+
+
 class StaticArchive:
     def __init__(self, file, mode: str = 'r',
                  size_mode: SizeMode = SizeMode.m64,
@@ -206,6 +226,7 @@ class StaticArchive:
             self._load_sig()
         else:
             self._write_sig()
+        self._setup_hdr()
 
     # signature
     @_lock
@@ -222,7 +243,11 @@ class StaticArchive:
         self.general_purpose_field = _decode(self._stream.read(DWORD))
         self._file_count = _decode(self._stream.read(QWORD))
         self._size_mode = self._stream.read(BYTE)[0]
-        self._crc = bool(self._stream.read(BYTE)[0])
+        flags = self._stream.read(BYTE)[0]
+        # extensions, front coded names and newer size modes are C++ only
+        if flags & ~SIG_CRC or self._size_mode >= len(CONV_MODE):
+            raise ValueError('Archive uses signature extensions, which are only supported by the C++ implementation')
+        self._crc = bool(flags & SIG_CRC)
 
     @_lock
     def _write_sig(self):
@@ -234,15 +259,16 @@ class StaticArchive:
         self._stream.write(_encode(self._crc, BYTE))
 
     # entry header
+    def _setup_hdr(self):
+        # crc and size behind the name are decoded by one struct, picked once per mode
+        tail = struct.Struct('<' + ('I' if self._crc else '') + STRUCT_MODE[self._size_mode])
+        self._hdr_tail_size = tail.size
+        self._unpack_hdr_tail = tail.unpack if self._crc else lambda data: (None, *tail.unpack(data))
+
     def _read_hdr(self):
         ns = self._stream.read(BYTE)[0]
         name = self._stream.read(ns).decode(ENCODING)
-
-        crc = None
-        if self._crc:
-            crc = _decode(self._stream.read(DWORD))
-
-        ds = _decode(self._stream.read(CONV_MODE[self._size_mode]))
+        crc, ds = self._unpack_hdr_tail(self._stream.read(self._hdr_tail_size))
         return name, crc, ds
 
     def _write_hdr(self, name, crc, ds):
@@ -288,7 +314,7 @@ class StaticArchive:
         assert count == ds
 
         if self._crc:
-            self._stream.seek(p - (DWORD + QWORD))
+            self._stream.seek(p - (DWORD + CONV_MODE[self._size_mode]))
             self._stream.write(_encode(last_csum, DWORD))
         self._file_count += 1
 
@@ -334,9 +360,12 @@ class StaticArchive:
         )
 
 
-    def add(self, path: str, verbose=False, only_names=False, ignore=False) -> List[FileInfo]:
+    def add(self, path: str, verbose=False, only_names=False, ignore=False, auto_size_mode=False) -> AddResult:
         """
         Add a directory or a single file into the archive recursively.
+        All inputs are checked against the maximal filesize before anything is written,
+        with auto_size_mode an empty archive switches to the smallest size mode that fits.
+        The result tells the size mode and the projected header bytes.
         """
         appended_files = list()
         target_files = list()
@@ -357,19 +386,40 @@ class StaticArchive:
 
             trace_dir(path)
 
+        if only_names:
+            names = [os.path.basename(target) for target in target_files]
+        elif is_file:
+            names = list(target_files)
+        else:
+            names = [os.path.relpath(target, path) for target in target_files]
+
+        # inputs which cannot be stat'ed fail when they are appended
+        sizes = []
+        for target in target_files:
+            try:
+                sizes.append(os.path.getsize(target))
+            except OSError:
+                sizes.append(0)
+        largest = max(sizes, default=0)
+
+        if auto_size_mode and self._file_count == 0:
+            self._size_mode = SizeMode.fitting(largest)
+            self._setup_hdr()
+        if largest > self.max_filesize and not ignore:
+            raise ValueError('%i bytes exceed the maximal filesize of the size mode' % largest)
+
+        result = AddResult(
+            appended_files,
+            SizeMode(self._size_mode),
+            sum(BYTE + len(name.encode(ENCODING)) + (DWORD if self._crc else 0) + CONV_MODE[self._size_mode] for name in names),
+            sum(sizes),
+        )
+
         ts = shutil.get_terminal_size((40, 40)).columns // 2
-        for i, target in enumerate(target_files):
+        for i, (target, name) in enumerate(zip(target_files, names)):
             if verbose:
                 self._bar(i, len(target_files), ts)
 
-            if only_names:
-                name = os.path.basename(target)
-            else:
-                if is_file:
-                    name = target
-                else:
-                    name = os.path.relpath(target, path)
-
             try:
                 with open(target, 'rb') as f:
                     appended_files.append(self.append(name, f))
@@ -381,7 +431,7 @@ class StaticArchive:
         if verbose:
             print('\r')
 
-        return appended_files
+        return result
 
     def extract(self, path: str, names: list = None, verbose=False):
         if not isdir(path):
@@ -507,6 +557,110 @@ class StaticArchive:
         self.close()
 
 
+class Loader:
+    """
+    Reads entries of an archive on background threads into a bounded queue,
+    so consumers only pop ready payloads. The workers block while the queue
+    is full. Payloads are delivered in completion order, several consumers
+    may pop at once.
+    File backed archives are read with os.pread, without moving the stream.
+    """
+    def __init__(self, archive: StaticArchive, files: List[FileInfo] = None,
+                 io_threads: int = 2, capacity: int = 64):
+        if archive.writeable():
+            archive._stream.flush()
+
+        self._archive = archive
+        self._files = list(archive.file_infos()) if files is None else list(files)
+        self._queue = queue.Queue(maxsize=capacity)
+        self._next = 0
+        self._claimed = 0
+        self._next_lock = threading.Lock()
+        self._claim_lock = threading.Lock()
+        self._stream_lock = threading.Lock()
+        self._stop = threading.Event()
+
+        try:
+            self._fd = archive._stream.fileno()
+        except (AttributeError, io.UnsupportedOperation):
+            self._fd = None
+
+        self._threads = [threading.Thread(target=self._work, daemon=True) for _ in range(max(io_threads, 1))]
+        for thread in self._threads:
+            thread.start()
+
+    def _read(self, info: FileInfo) -> bytes:
+        if self._fd is not None:
+            data = os.pread(self._fd, info.size, info.data_offset)
+        else:
+            with self._stream_lock:
+                self._archive._stream.seek(info.data_offset)
+                data = self._archive._stream.read(info.size)
+
+        if len(data) != info.size:
+            raise EOFError('Unexpected end of archive while reading %s' % info.name)
+        if self._archive.checks and self._archive.crc:
+            assert zlib.crc32(data) == info.crc, 'Checksum mismatch for %s' % info.name
+        return data
+
+    def _work(self):
+        while not self._stop.is_set():
+            with self._next_lock:
+                if self._next >= len(self._files):
+                    return
+                info = self._files[self._next]
+                self._next += 1
+
+            try:
+                item = (info, self._read(info))
+            except Exception as e:
+                item = e
+
+            while not self._stop.is_set():
+                try:
+                    self._queue.put(item, timeout=0.1)
+                    break
+                except queue.Full:
+                    pass
+
+    def pop(self):
+        """ Next (FileInfo, bytes) pair, None once every file was delivered or the loader was closed. """
+        # a consumer claims its item before waiting, so no more consumers wait than items are left
+        with self._claim_lock:
+            if self._claimed >= len(self._files):
+                return None
+            self._claimed += 1
+
+        while True:
+            try:
+                item = self._queue.get(timeout=0.1)
+            except queue.Empty:
+                if self._stop.is_set():
+                    return None
+                continue
+
+            if isinstance(item, Exception):
+                self.close()
+                raise item
+            return item
+
+    def close(self):
+        """ Stops and joins the workers, payloads not yet popped are dropped. """
+        self._stop.set()
+        for thread in self._threads:
+            thread.join()
+
+    def __iter__(self):
+        while (item := self.pop()) is not None:
+            yield item
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+
 def main():
     args = parse_args()
 
@@ -518,6 +672,8 @@ def main():
         mode = SizeMode.m64
     else:
         mode = SizeMode.m64
+    # without a mode new archives get the smallest one that fits the sources
+    auto_size_mode = not (args.M16 or args.M32 or args.M64)
 
     cmd = args.cmd.lower()
     if cmd not in ('list', 'l') and args.src is None:
@@ -531,11 +687,15 @@ def main():
             write_crc=args.crc,
             checks=args.checks
         ) as sa:
-            sa.add(
+            result = sa.add(
                 args.src,
                 verbose=args.verbose,
                 only_names=args.names,
+                auto_size_mode=auto_size_mode,
             )
+            if args.verbose:
+                print('Size mode %s, about %i header bytes for %i data bytes'
+                      % (result.size_mode.name, result.header_bytes, result.data_bytes))
 
     elif cmd in ('append', 'a'):
         with StaticArchive(
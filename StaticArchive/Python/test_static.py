@@ -6,6 +6,7 @@ import zlib
 import shutil
 import logging
 import tempfile
+import threading
 import unittest
 import traceback
 
@@ -244,6 +245,30 @@ class TestStaticArchive(unittest.TestCase):
 
         clear(temp_path, t=True)
 
+    def test_auto_size_mode(self):
+        temp_path = join(tempfile.gettempdir(), 'test_static_auto')
+        clear(temp_path)
+        for i in range(5):
+            with open(join(temp_path, str(i)), 'wb') as f:
+                f.write(b'x' * (i * 1000))
+
+        with StaticArchive(join(tempfile.gettempdir(), 'test_auto.arch'), 'w') as sa:
+            result = sa.add(temp_path, auto_size_mode=True)
+            assert sa.size_mode == SizeMode.m16, sa.size_mode
+            assert result.size_mode == SizeMode.m16
+            assert len(result.files) == 5 and result.data_bytes == 10_000
+            assert result.header_bytes == 5 * (BYTE + 1 + DWORD + 2), result.header_bytes
+
+        with StaticArchive(join(tempfile.gettempdir(), 'test_auto.arch'), 'r') as sa:
+            assert sa.size_mode == SizeMode.m16
+            for info in sa.file_infos():
+                assert sa.read(info) == b'x' * info.size
+
+        assert SizeMode.fitting(0x1_0000) == SizeMode.m32
+        assert SizeMode.fitting(0x1_0000_0000) == SizeMode.m64
+        os.remove(join(tempfile.gettempdir(), 'test_auto.arch'))
+        clear(temp_path, t=True)
+
     @staticmethod
     def _gen_files(tp, count, data_amount):
         files_path = join(tp, 'test_files')
@@ -288,6 +313,34 @@ class TestStaticArchive(unittest.TestCase):
 
         clear(temp_path, t=True)
 
+    def test_loader(self):
+        temp_path = join(tempfile.gettempdir(), 'test_static_loader')
+        clear(temp_path)
+
+        files = {str(i): os.urandom(i * 10) for i in range(50)}
+        with StaticArchive(join(temp_path, 'test_loader.arch'), 'w') as sa:
+            for name, data in files.items():
+                sa.append(name, data)
+
+        for stream in (open(join(temp_path, 'test_loader.arch'), 'rb'),
+                       BytesIO(open(join(temp_path, 'test_loader.arch'), 'rb').read())):
+            with StaticArchive(stream, 'r') as sa, Loader(sa, io_threads=3, capacity=4) as loader:
+                loaded = {info.name: data for info, data in loader}
+                assert loaded == files
+                assert loader.pop() is None
+
+        # every item reaches exactly one of several consumers, all of them see the end
+        with StaticArchive(join(temp_path, 'test_loader.arch'), 'r') as sa, Loader(sa, capacity=4) as loader:
+            popped = [[] for _ in range(4)]
+            consumers = [threading.Thread(target=lambda out: out.extend(loader), args=(out,)) for out in popped]
+            for consumer in consumers:
+                consumer.start()
+            for consumer in consumers:
+                consumer.join()
+            assert sorted(info.name for out in popped for info, _ in out) == sorted(files)
+
+        clear(temp_path, t=True)
+
     def test_create_samples(self):
         try:
             os.mkdir('samples')